@@ -0,0 +1,16 @@
+@echo off
+REM Benchmark regression gate for Windows, exits non-zero when a benchmark got slower than bench_baseline_msvc.json
+REM The committed bench_baseline.json is for bench_gate.sh on the reference machine (README.md, "Benchmark gate"),
+REM timings only compare on one machine and build, so this one compares against a baseline written here:
+REM   bench_gate.bat --write-baseline bench_baseline_msvc.json
+REM rerun that whenever benchmarks are added or removed
+call compile.bat tool_release bench
+IF "%1"=="--write-baseline" (
+    bin\bench_release.exe --pin 1 --render --runs 5 %*
+    exit /b %ERRORLEVEL%
+)
+IF NOT EXIST bench_baseline_msvc.json (
+    echo no bench_baseline_msvc.json, write one with: bench_gate.bat --write-baseline bench_baseline_msvc.json
+    exit /b 2
+)
+bin\bench_release.exe --pin 1 --render --runs 3 --baseline bench_baseline_msvc.json %*
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Benchmark regression gate for the reference machine, exits non-zero when a
+# benchmark got slower than bench_baseline.json. Same as bench_gate.bat with
+# gcc -O2, since the committed baseline only compares with the build and
+# machine that wrote it (see "Benchmark gate" in README.md).
+#   ./bench_gate.sh                                     compare
+#   ./bench_gate.sh --write-baseline bench_baseline.json  write it again
+# SDL_LIB_DIR is where libSDL2, _image, _ttf and _mixer are if not on the
+# system library path.
+cd "$(dirname "$0")" || exit 2
+mkdir -p bin
+INC="-Ilib/SDL2-2.0.7/include -Ilib/SDL2_ttf-2.0.14/include -Ilib/SDL2_image-2.0.3/include -Ilib/SDL2_mixer-2.0.4/include -Isrc/headers"
+LIBS="-lSDL2 -lSDL2_image -lSDL2_ttf -lSDL2_mixer -pthread"
+if [ -n "$SDL_LIB_DIR" ]; then
+    LIBS="-L$SDL_LIB_DIR -Wl,-rpath,$SDL_LIB_DIR $LIBS"
+fi
+g++ -std=c++17 -O2 -DNDEBUG $INC src/tools/bench.cpp src/source/*.cpp $LIBS -o bin/bench_release || exit 2
+
+# --render gates asteroids_render too, it runs on the dummy video driver. The
+# baseline takes more runs than a check so it covers the noise between runs.
+if [ "$1" = "--write-baseline" ]; then
+    exec bin/bench_release --pin 0 --render --runs 5 "$@"
+fi
+if [ ! -f bench_baseline.json ]; then
+    echo "no bench_baseline.json, write one with: ./bench_gate.sh --write-baseline bench_baseline.json"
+    exit 2
+fi
+exec bin/bench_release --pin 0 --render --runs 3 --baseline bench_baseline.json "$@"
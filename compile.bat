@@ -1,6 +1,16 @@
 @echo off
 
 SET ARG1=%1
+SET ARG2=%2
+SET ARG3=%3
+
+REM --- "compile.bat fixed" or "compile.bat tool <name> fixed" simulate in Q16.16 fixed point ---
+REM --- "compile.bat tool_release <name> [fixed]" builds a tool optimized, for benchmarks ---
+SET DEFINES=
+SET SUFFIX=
+IF "%ARG1%"=="fixed" SET DEFINES=/DASTEROIDS_FIXED_POINT
+IF "%ARG3%"=="fixed" SET DEFINES=/DASTEROIDS_FIXED_POINT
+IF "%ARG3%"=="fixed" SET SUFFIX=_fixed
 
 call console.bat 
 
@@ -24,9 +34,23 @@ echo.
 IF "%ARG1%"=="release" (
     echo ---- RELEASE BUILD, no optimizations or completed config ---- 
 
-    cl /EHsc %SOURCE% %SOURCEEXTERN% /I %SDLINC% /I %SDL_TTFINC% /I %~dp0src\extern\ /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% SDL2main.lib SDL2.lib SDL2_ttf.lib opengl32.lib /out:%OUTPUT% /SUBSYSTEM:CONSOLE
+    cl /std:c++17 /EHsc %SOURCE% %SOURCEEXTERN% /I %SDLINC% /I %SDL_TTFINC% /I %~dp0src\extern\ /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% SDL2main.lib SDL2.lib SDL2_ttf.lib opengl32.lib /out:%OUTPUT% /SUBSYSTEM:CONSOLE
 
     echo ---- COMPLETED RELEASE BUILD ---- 
+) ELSE IF "%ARG1%"=="tool_release" (
+    echo ---- OPTIMIZED TOOL BUILD: %ARG2% ---- 
+
+    REM --- like tool but /O2 /MT without _DEBUG, for timings, writes bin\NAME_release.exe ---
+	cl /nologo /std:c++17 /EHsc /W4 /MP /O2 /MT /DNDEBUG /wd4996 /wd4100 %DEFINES% %~dp0src\tools\%ARG2%.cpp %~dp0src\source\* /I %SDLINC% /I %SDL_TTFINC% /I %SDL_IMGINC% /I %AUDIO_INC% /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% /LIBPATH:%SDL_IMGLIB% /LIBPATH:%AUDIO_LIB% SDL2main.lib SDL2.lib SDL2_ttf.lib SDL2_image.lib SDL2_mixer.lib opengl32.lib /out:%~dp0bin\%ARG2%_release%SUFFIX%.exe /SUBSYSTEM:CONSOLE
+
+    echo ---- COMPLETED OPTIMIZED TOOL BUILD ---- 
+) ELSE IF "%ARG1%"=="tool" (
+    echo ---- TOOL BUILD: %ARG2% ---- 
+
+    REM --- tools have their own main in src\tools\ and link the engine sources ---
+	cl /nologo /std:c++17 /EHsc /W4 /MP /MTd /wd4996 /wd4100 /DEBUG /Zi %DEFINES% %~dp0src\tools\%ARG2%.cpp %~dp0src\source\* /I %SDLINC% /I %SDL_TTFINC% /I %SDL_IMGINC% /I %AUDIO_INC% /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% /LIBPATH:%SDL_IMGLIB% /LIBPATH:%AUDIO_LIB% SDL2main.lib SDL2.lib SDL2_ttf.lib SDL2_image.lib SDL2_mixer.lib opengl32.lib /out:%~dp0bin\%ARG2%%SUFFIX%.exe /SUBSYSTEM:CONSOLE
+
+    echo ---- COMPLETED TOOL BUILD ---- 
 ) ELSE (
     echo ---- DEBUG BUILD ---- 
 
@@ -43,7 +67,7 @@ IF "%ARG1%"=="release" (
     REM cl /MP /MTd /DEBUG /Zi /EHsc %SOURCE% /I %SDLINC% /I %SDL_TTFINC% /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% /LIBPATH:.\ SDL2main.lib SDL2.lib SDL2_ttf.lib opengl32.lib extern.lib /out:%OUTPUT% /SUBSYSTEM:CONSOLE
 
 	REM --- ORIGINAL BUILD ALL ---
-	cl /nologo /EHsc /W4 /MP /MTd /wd4996 /wd4100 /DEBUG /Zi %SOURCE% /I %SDLINC% /I %SDL_TTFINC% /I %SDL_IMGINC% /I %AUDIO_INC% /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% /LIBPATH:%SDL_IMGLIB% /LIBPATH:%AUDIO_LIB% SDL2main.lib SDL2.lib SDL2_ttf.lib SDL2_image.lib SDL2_mixer.lib opengl32.lib /out:%OUTPUT% /SUBSYSTEM:CONSOLE
+	cl /nologo /std:c++17 /EHsc /W4 /MP /MTd /wd4996 /wd4100 /DEBUG /Zi %DEFINES% %SOURCE% /I %SDLINC% /I %SDL_TTFINC% /I %SDL_IMGINC% /I %AUDIO_INC% /I %~dp0src\headers\ /link /LIBPATH:%SDLLIB% /LIBPATH:%SDL_TTFLIB% /LIBPATH:%SDL_IMGLIB% /LIBPATH:%AUDIO_LIB% SDL2main.lib SDL2.lib SDL2_ttf.lib SDL2_image.lib SDL2_mixer.lib opengl32.lib /out:%OUTPUT% /SUBSYSTEM:CONSOLE
 	
     echo ---- COMPLETED DEBUG BUILD ---- 
 )
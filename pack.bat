@@ -0,0 +1,4 @@
+@echo off
+REM Builds the packed asset archive, the game uses it when present
+call compile.bat tool packer
+bin\packer.exe bin\data\assets.pak data ship.png pixeltype.ttf
@@ -1,18 +1,95 @@
 #include "engine.h"
 #include "renderer.h"
+#include "vec2.h"
+
+// Positions, velocities and angles are simulated in Scalar. Building with
+// ASTEROIDS_FIXED_POINT makes it Q16.16 so lockstep and replays agree
+// bit for bit across compilers and platforms, at some cost in precision.
+#ifdef ASTEROIDS_FIXED_POINT
+typedef Fixed Scalar;
+#else
+typedef float Scalar;
+#endif
+typedef Vec2T<Scalar> Vec2;
 
 struct GameState {
 	bool inactive = false;
 	float inactive_timer = 0.0f;
 	float pause_time = 2.0f;
 	int level = 1;
+	// the only source of randomness in the simulation
+	RandomGenerator rng;
 	SDL_Color text_color = { 220, 220, 220, 255 };
 	SDL_Color asteroid_color = { 240, 240, 240, 255 };
-} game_state;
+};
+
+// Resource handles, resolved once in asteroids_load
+struct GameResources {
+	SpriteHandle ship;
+	FontHandle font_normal;
+	FontHandle font_gameover;
+} resources;
 
 void game_state_inactivate();
 void game_state_reset();
 
+// Input of one player for one tick. This is all the simulation reads from the
+// outside, so a seed and these bits reproduce a game exactly.
+enum InputBits {
+	INPUT_UP = 1 << 0,
+	INPUT_DOWN = 1 << 1,
+	INPUT_LEFT = 1 << 2,
+	INPUT_RIGHT = 1 << 3,
+	INPUT_FIRE = 1 << 4,
+	INPUT_SHIELD = 1 << 5
+};
+
+// How system_collisions finds the pairs to test. ALL_PAIRS tests every pair
+// in batches, SWEEP sorts the bodies along x and tests those overlapping on
+// it, AUTO picks one every tick from how crowded x is (see Broadphase).
+enum BroadphaseType {
+	BROADPHASE_AUTO,
+	BROADPHASE_ALL_PAIRS,
+	BROADPHASE_SWEEP
+};
+
+// Kinds of body system_collisions tests against each other. A pair of
+// layers lists the later one first, e.g. asteroid and ship.
+enum CollisionLayer {
+	LAYER_SHIP,
+	LAYER_ASTEROID,
+	LAYER_BULLET,
+	LAYER_COUNT
+};
+
+enum CollisionLayerBits {
+	LAYER_SHIP_BIT = 1 << LAYER_SHIP,
+	LAYER_ASTEROID_BIT = 1 << LAYER_ASTEROID,
+	LAYER_BULLET_BIT = 1 << LAYER_BULLET
+};
+
+// What queue_event does with an event for a target, the faction it is for,
+// that already has one of its type queued this tick (see Events)
+enum EventMerge {
+	// queue it too
+	EVENT_MERGE_NONE,
+	// drop it, the first one stands
+	EVENT_MERGE_FIRST,
+	// add its amount into the first, the score of AsteroidDestroyed, types
+	// without an amount keep the first
+	EVENT_MERGE_SUM
+};
+
+// Who flies a ship. Players read their input bits from asteroids_tick, the
+// others are bots whose pilot works them out from the world (see Pilots).
+enum PilotType {
+	PILOT_PLAYER,
+	PILOT_HUNTER,
+	PILOT_SENTRY,
+	PILOT_SPINNER,
+	PILOT_COUNT
+};
+
 struct InputMapping {
 	SDL_Scancode up;
 	SDL_Scancode down;
@@ -43,20 +120,25 @@ struct AsteroidsConfig {
 	float player_shield_time = 2.0f;
 	float player_shield_inactive_time = 6.0f;
 	int asteroid_count_increase_per_level = 2;
-} config;
-
-struct Position {
-	// Position
-	float x, y;
-};
-
-struct Velocity {
-	// Position
-	float x, y;
-};
-
-struct Rotation {
-	float x, y;
+	// ships spawned by game_state_reset, bots take the factions after enemy_faction
+	int player_count = 2;
+	int bot_count = 0;
+	int bot_pilot = PILOT_HUNTER;
+	int broadphase = BROADPHASE_AUTO;
+	// asteroids and bullets are kept sorted by x in their arrays, so the
+	// broadphase sweep walks memory in order. Hit order follows the storage
+	// order, so games differ from unsorted ones.
+	bool spatial_order = false;
+	// Layers each layer collides with, two layers are tested when both have
+	// the bit of the other. Bullets never hit ships of their own faction.
+	uint8_t collision_masks[LAYER_COUNT] = { LAYER_ASTEROID_BIT, LAYER_SHIP_BIT | LAYER_BULLET_BIT, LAYER_ASTEROID_BIT };
+	// ships collide by the pixels of their sprite once their circles touch,
+	// needs PixelCollisions::ship_masks, asteroids_tick refuses to run without
+	// them
+	bool pixel_collisions = false;
+	// EventMerge of each Event::EventType. A ship is only hit once a tick and
+	// scores add up, so these give the same game as queueing everything.
+	uint8_t event_merge[4] = { EVENT_MERGE_NONE, EVENT_MERGE_NONE, EVENT_MERGE_SUM, EVENT_MERGE_FIRST };
 };
 
 struct PlayerInput {
@@ -79,21 +161,22 @@ struct Shield {
 
 struct Ship {
 	// Angle
-	float angle = 0;
+	Scalar angle = 0;
 	float radius = 7;
 	int health = 3;
 	int faction = 0;
 	int score = 0;
+	int pilot = PILOT_PLAYER;
 	float inactive_timer = 0;
 	Shield shield;
 	PlayerInput input;
-	Position position;
-	Velocity velocity;
+	Vec2 position;
+	Vec2 velocity;
 };
 
 struct Asteroid {
-	Position position;
-	Velocity velocity;
+	Vec2 position;
+	Vec2 velocity;
 	int size;
 
 	float radius() {
@@ -107,35 +190,37 @@ struct Asteroid {
 };
 
 struct Bullet {
-	Position position;
-	Velocity velocity;
+	Vec2 position;
+	Vec2 velocity;
 	float time_to_live;
 	float radius;
 	int faction;
 };
 
 struct ShotSpawnData {
-	Position position;
-	Rotation rotation;
+	Vec2 position;
+	Vec2 rotation;
 	float time_to_live;
 	int faction;
 };
 
 struct AsteroidSpawnData {
-	Position position;
-	Velocity velocity;
+	Vec2 position;
+	Vec2 velocity;
 	int size;
 };
 
 struct AsteroidDestroyedData {
 	int size;
 	int faction;
+	int score;
 };
 
 struct ShipHitData {
 	int faction;
 };
 
+// Payloads are stored inline so queued events can be copied with the world
 struct Event {
 	enum EventType {
 		FireBullet,
@@ -143,27 +228,79 @@ struct Event {
 		AsteroidDestroyed,
 		ShipHit
 	} type;
-	void *data;
+	union {
+		ShotSpawnData shot_spawn;
+		AsteroidSpawnData asteroid_spawn;
+		AsteroidDestroyedData asteroid_destroyed;
+		ShipHitData ship_hit;
+	};
 };
-void queue_event(Event e);
+static_assert(Event::ShipHit + 1 == sizeof(AsteroidsConfig::event_merge), "a merge rule for each event type");
+void queue_event(const Event &e);
+
+// Everything the simulation carries from one tick to the next. The MAX_ values
+// are the capacities of a normal game, world_set_capacity changes them.
+struct GameWorld {
+	static const unsigned MAX_SHIPS = 100;
+	static const unsigned MAX_ASTEROIDS = 100;
+	static const unsigned MAX_BULLETS = 1000;
+	// a shot from every ship plus the splits and hits of a busy tick
+	static const unsigned MAX_EVENTS = 1000;
+
+	GameState game_state;
+	AsteroidsConfig config;
+	unsigned ship_n = 0;
+	std::vector<Ship> ships;
+	unsigned asteroid_n = 0;
+	std::vector<Asteroid> asteroids;
+	unsigned bullets_n = 0;
+	std::vector<Bullet> bullets;
+	unsigned event_n = 0;
+	std::vector<Event> event_queue;
+
+	GameWorld() : ships(MAX_SHIPS), asteroids(MAX_ASTEROIDS), bullets(MAX_BULLETS), event_queue(MAX_EVENTS) {}
+} world;
+
+// For stress tests. Live entities past a new capacity are dropped and
+// snapshots of the world need world_snapshot_init again.
+void world_set_capacity(GameWorld &w, unsigned ships, unsigned asteroids, unsigned bullets, unsigned events) {
+	w.ship_n = std::min(w.ship_n, ships);
+	w.asteroid_n = std::min(w.asteroid_n, asteroids);
+	w.bullets_n = std::min(w.bullets_n, bullets);
+	w.event_n = std::min(w.event_n, events);
+	w.ships.resize(ships);
+	w.ships.shrink_to_fit();
+	w.asteroids.resize(asteroids);
+	w.asteroids.shrink_to_fit();
+	w.bullets.resize(bullets);
+	w.bullets.shrink_to_fit();
+	w.event_queue.resize(events);
+	w.event_queue.shrink_to_fit();
+}
 
-unsigned ship_n = 0;
-std::vector<Ship> ships(100);
-unsigned asteroid_n = 0;
-std::vector<Asteroid> asteroids(100);
-unsigned bullets_n = 0;
-std::vector<Bullet> bullets(1000);
-unsigned event_n;
-std::vector<Event> event_queue(100);
+// Players start in the middle, bots on a spiral around it so they do not
+// all sit under the same asteroid
+Vec2 ship_spawn_position(int faction) {
+	Vec2 center = { gw / 2.0f, gh / 2.0f };
+	int bot = faction - world.config.enemy_faction - 1;
+	if(bot < 0) {
+		return center;
+	}
+	// golden angle steps, in half degrees to stay exact
+	Scalar angle = Scalar(bot * 275 % 720) * 0.5f;
+	Scalar distance = Scalar(40 + bot % 8 * 16);
+	return center + Math::direction_deg(angle) * distance;
+}
 
-void spawn_player(int faction) {
+void spawn_ship(int faction, int pilot) {
+	if(world.ship_n >= world.ships.size())
+		return;
 	Ship player;
 	player.faction = faction;
+	player.pilot = pilot;
 	player.score = 0;
-	player.position.x = gw / 2.0f;
-	player.position.y = gh / 2.0f;
-	player.velocity.x = 0;
-	player.velocity.y = 0;
+	player.position = ship_spawn_position(faction);
+	player.velocity = { 0, 0 };
 	player.angle = 0;
 	player.input.move_x = 0;
 	player.input.move_y = 0;
@@ -173,364 +310,1299 @@ void spawn_player(int faction) {
 	player.input.shield = false;
 	player.shield.inactive_timer = 0;
 	player.shield.active_timer = 0;
-	ships[ship_n++] = player;
+	world.ships[world.ship_n++] = player;
+}
+
+void spawn_player(int faction) {
+	spawn_ship(faction, PILOT_PLAYER);
 }
 
-void spawn_bullet(Position position, Rotation direction, int faction, float time_to_live) {
-	Bullet b = { position };
+void spawn_bullet(Vec2 position, Vec2 direction, int faction, float time_to_live) {
+	if(world.bullets_n >= world.bullets.size())
+		return;
+	Bullet b = {};
+	b.position = position;
 	b.time_to_live = time_to_live;
 	b.faction = faction;
-	if(faction == config.player_faction_1 || faction == config.player_faction_2) {
-		b.velocity.x = direction.x * config.player_bullet_speed;
-		b.velocity.y = direction.y * config.player_bullet_speed;
-		b.radius = config.player_bullet_size;
+	if(faction != world.config.enemy_faction) {
+		b.velocity = direction * world.config.player_bullet_speed;
+		b.radius = world.config.player_bullet_size;
 	} 
-	bullets[bullets_n++] = b;
+	world.bullets[world.bullets_n++] = b;
 }
 
-void spawn_asteroid(Position position, Velocity velocity, int size) {
-	asteroids[asteroid_n].position = position;
-	asteroids[asteroid_n].velocity = velocity;
-	asteroids[asteroid_n].size = size;
-	asteroid_n++;
+void spawn_asteroid(Vec2 position, Vec2 velocity, int size) {
+	if(world.asteroid_n >= world.asteroids.size())
+		return;
+	world.asteroids[world.asteroid_n].position = position;
+	world.asteroids[world.asteroid_n].velocity = velocity;
+	world.asteroids[world.asteroid_n].size = size;
+	world.asteroid_n++;
 }
 
 void spawn_asteroid_wave() {
-	for(int i = 0; i < game_state.level + config.asteroid_count_increase_per_level; ++i) {
-		Position position;
-		Velocity velocity;
-		position.x = RNG::range_f(0, (float)gw);
-		position.y = RNG::range_f(0, (float)gh);
-		velocity.x = RNG::range_f(0, 100) / 100.0f - 0.5f;
-		velocity.y = RNG::range_f(0, 100) / 100.0f - 0.5f;
+	int count = world.game_state.level + world.config.asteroid_count_increase_per_level;
+	count = std::min(count, (int)GameWorld::MAX_ASTEROIDS);
+	// position and velocity of the whole wave in one draw
+	float random[4 * GameWorld::MAX_ASTEROIDS];
+	RNG::fill_range_f(world.game_state.rng, random, 4 * count, 0.0f, 1.0f);
+	for(int i = 0; i < count; ++i) {
+		Vec2 position = { random[i * 4 + 0] * gw, random[i * 4 + 1] * gh };
+		Vec2 velocity = { random[i * 4 + 2] - 0.5f, random[i * 4 + 3] - 0.5f };
 		int size = 1;
 		spawn_asteroid(position, velocity, size);
 	}
 }
 
-inline void update_player_input(unsigned id, PlayerInput &pi) {
+uint8_t input_bits_from_keyboard(unsigned id) {
+	InputMapping key_map = input_maps[id];
+	uint8_t bits = 0;
+	if(Input::key_down(key_map.up)) bits |= INPUT_UP;
+	if(Input::key_down(key_map.down)) bits |= INPUT_DOWN;
+	if(Input::key_down(key_map.left)) bits |= INPUT_LEFT;
+	if(Input::key_down(key_map.right)) bits |= INPUT_RIGHT;
+	if(Input::key_down(key_map.fire)) bits |= INPUT_FIRE;
+	if(Input::key_down(key_map.shield)) bits |= INPUT_SHIELD;
+	return bits;
+}
+
+inline void update_player_input(uint8_t bits, PlayerInput &pi) {
 	pi.move_x = 0;
 	pi.move_y = 0;
 	pi.fire_x = 0;
 	pi.fire_y = 0;
 	pi.shield = false;
 
-	InputMapping key_map = input_maps[id];
-
-	if(Input::key_down(key_map.up)) {
+	if(bits & INPUT_UP) {
 		pi.move_y = 1;
-	} else if(Input::key_down(key_map.down)) {
+	} else if(bits & INPUT_DOWN) {
 		pi.move_y = -1;
 	} 
 	
-	if(Input::key_down(key_map.left)) {
+	if(bits & INPUT_LEFT) {
 		pi.move_x = -1;
-	} else if(Input::key_down(key_map.right)) {
+	} else if(bits & INPUT_RIGHT) {
 		pi.move_x = 1;
 	}
 
 	pi.fire_cooldown = Math::max_f(0.0f, pi.fire_cooldown - Time::delta_time);
-	if(Input::key_down(key_map.fire)) {
+	if(bits & INPUT_FIRE) {
 		pi.fire_x = pi.fire_y = 1;
 	}
 
-	if(Input::key_down(key_map.shield)) {
+	if(bits & INPUT_SHIELD) {
 		pi.shield = true;
 	}
 }
 
-inline void update_position(Position &position, Velocity &velocity) {
-	position.x += velocity.x;
-	position.y += velocity.y;
-}
-
-inline void keep_in_bounds(Position &p) {
+inline void keep_in_bounds(Vec2 &p) {
+#ifdef ASTEROIDS_FIXED_POINT
+	p.x = Math::wrap(p.x, Fixed(gw));
+	p.y = Math::wrap(p.y, Fixed(gh));
+#else
 	if(p.x < 0) p.x = (float)gw;
 	if(p.x > gw) p.x = 0.0f;
 	if(p.y < 0) p.y = (float)gh;
 	if(p.y > gh) p.y = 0.0f;
+#endif
 }
 
 inline void update_player_movement(Ship &sdata) {
 	PlayerInput &pi = sdata.input;
-	Velocity &velocity = sdata.velocity;
-	Position &position = sdata.position;
+	Vec2 &velocity = sdata.velocity;
+	Vec2 &position = sdata.position;
 
 	// Update rotation based on rotational speed
-	// for other objects than player input once
-	sdata.angle += pi.move_x * config.rotation_speed;
-	float rotation = sdata.angle / Math::RAD_TO_DEGREE;
-
-	float direction_x = cos(rotation);
-	float direction_y = sin(rotation);
-	velocity.x += direction_x * pi.move_y * config.acceleration;
-	velocity.y += direction_y * pi.move_y * config.acceleration;
+	// for other objects than player input once. Kept in [0, 360), a ship
+	// spinning for two minutes would overflow Q16.16 otherwise.
+	sdata.angle = Math::wrap(sdata.angle + pi.move_x * world.config.rotation_speed, Scalar(360));
+
+	Vec2 direction = Math::direction_deg(sdata.angle);
+	velocity += direction * pi.move_y * world.config.acceleration;
 	
-	position.x += velocity.x;
-	position.y += velocity.y;
+	position += velocity;
 
 	// Use Stokes' law to apply drag to the object
-	velocity.x = velocity.x - velocity.x * config.drag;
-	velocity.y = velocity.y - velocity.y * config.drag;
+	velocity = velocity - velocity * world.config.drag;
 
 	if(pi.fire_cooldown <= 0.0f && Math::length_vector_f(pi.fire_x, pi.fire_y) > 0.5f) {
-		Event e = { Event::FireBullet };
-		ShotSpawnData *d = new ShotSpawnData;
+		Event e;
+		e.type = Event::FireBullet;
+		ShotSpawnData *d = &e.shot_spawn;
 		d->position = position;
-		d->rotation.x = direction_x;
-		d->rotation.y = direction_y;
-		d->time_to_live = config.bullet_time_to_live;
+		d->rotation = direction;
+		d->time_to_live = world.config.bullet_time_to_live;
 		d->faction = sdata.faction;
-		e.data = d;
 		queue_event(e);
-		pi.fire_cooldown = config.fire_cooldown;
+		pi.fire_cooldown = world.config.fire_cooldown;
 	}
 }
 
+// Bot pilots, each returns the input bits for a ship this tick. They only read
+// the world, so bots are simulated like everything else and a seed plus the
+// player inputs still reproduce a game.
+namespace Pilots {
+	typedef uint8_t (*Pilot)(const Ship &ship);
+
+	inline Scalar abs(Scalar value) {
+		return value < 0 ? -value : value;
+	}
+
+	// Closest asteroid by taxicab distance, which cannot overflow Q16.16 and
+	// is close enough to pick a target. -1 when the field is empty.
+	int nearest_asteroid(Vec2 position, Scalar &distance) {
+		int nearest = -1;
+		for(unsigned i = 0; i < world.asteroid_n; ++i) {
+			Vec2 d = world.asteroids[i].position - position;
+			Scalar dist = abs(d.x) + abs(d.y);
+			if(nearest < 0 || dist < distance) {
+				nearest = (int)i;
+				distance = dist;
+			}
+		}
+		return nearest;
+	}
+
+	// Turns toward target and fires once it is within about 11 degrees of the nose
+	uint8_t aim(const Ship &ship, Vec2 target) {
+		Vec2 heading = Math::direction_deg(ship.angle);
+		Vec2 to = target - ship.position;
+		Scalar side = heading.x * to.y - heading.y * to.x;
+		Scalar ahead = Math::dot(heading, to);
+		uint8_t bits = side > 0 ? INPUT_RIGHT : INPUT_LEFT;
+		if(ahead > 0 && abs(side) < ahead * 0.2f) {
+			bits |= INPUT_FIRE;
+		}
+		return bits;
+	}
+
+	// Shields when an asteroid is about to hit
+	uint8_t guard(const Ship &ship, Asteroid &a, Scalar distance) {
+		if(ship.shield.inactive_timer <= 0 && distance < Scalar(a.radius() + ship.radius + 24.0f)) {
+			return INPUT_SHIELD;
+		}
+		return 0;
+	}
+
+	// Chases the nearest asteroid and shoots it
+	uint8_t hunter(const Ship &ship) {
+		Scalar distance = 0;
+		int target = nearest_asteroid(ship.position, distance);
+		if(target < 0) {
+			return 0;
+		}
+		Asteroid &a = world.asteroids[target];
+		uint8_t bits = aim(ship, a.position) | guard(ship, a, distance);
+		if(distance > Scalar(120)) {
+			bits |= INPUT_UP;
+		}
+		return bits;
+	}
+
+	// Stays put and shoots the nearest asteroid
+	uint8_t sentry(const Ship &ship) {
+		Scalar distance = 0;
+		int target = nearest_asteroid(ship.position, distance);
+		if(target < 0) {
+			return 0;
+		}
+		Asteroid &a = world.asteroids[target];
+		return aim(ship, a.position) | guard(ship, a, distance);
+	}
+
+	// Turns in place and fires without stopping, its angle goes round and
+	// round for as long as it lives
+	uint8_t spinner(const Ship &ship) {
+		Scalar distance = 0;
+		int target = nearest_asteroid(ship.position, distance);
+		uint8_t bits = INPUT_RIGHT | INPUT_FIRE;
+		return target < 0 ? bits : bits | guard(ship, world.asteroids[target], distance);
+	}
+
+	const Pilot pilots[PILOT_COUNT] = { NULL, hunter, sentry, spinner };
+}
+
 void system_asteroid_spawn() {
-	if(asteroid_n == 0) {
-		game_state.level++;
+	// the field is cleared every tick while inactive, game_state_reset spawns the next wave
+	if(world.asteroid_n == 0 && !world.game_state.inactive) {
+		world.game_state.level++;
 		spawn_asteroid_wave();
 	}
 }
 
 void system_shield() {
-	for(unsigned i = 0; i < ship_n; ++i) {
-		Shield &s = ships[i].shield;
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		Shield &s = world.ships[i].shield;
 		s.active_timer = Math::max_f(0.0f, s.active_timer - Time::delta_time);
 		s.inactive_timer = Math::max_f(0.0f, s.inactive_timer - Time::delta_time);
-		PlayerInput &pi = ships[i].input;
+		PlayerInput &pi = world.ships[i].input;
 		if(pi.shield && s.inactive_timer <= 0.0f) {
-			s.active_timer = config.player_shield_time;
-			s.inactive_timer = config.player_shield_time + config.player_shield_inactive_time;
+			s.active_timer = world.config.player_shield_time;
+			s.inactive_timer = world.config.player_shield_time + world.config.player_shield_inactive_time;
 		}
 	}
 }
 
-void system_player_input() {
-	for(unsigned i = 0; i < ship_n; ++i) {
+void system_player_input(const uint8_t *inputs) {
+	for(unsigned i = 0; i < world.ship_n; ++i) {
 		// TODO: this should be another system or something 
 			// and when it is activated it should get a input component
 			// and a collision component or something like that 
-		ships[i].inactive_timer = Math::max_f(0.0f, ships[i].inactive_timer - Time::delta_time);
-		if(ships[i].inactive_timer <= 0) {
-			update_player_input(ships[i].faction, ships[i].input);
+		Ship &ship = world.ships[i];
+		ship.inactive_timer = Math::max_f(0.0f, ship.inactive_timer - Time::delta_time);
+		if(ship.inactive_timer <= 0) {
+			uint8_t bits = ship.pilot == PILOT_PLAYER ? inputs[ship.faction] : Pilots::pilots[ship.pilot](ship);
+			update_player_input(bits, ship.input);
 		}
 	}
 }
 
 void system_player_movement() {
-	for(unsigned i = 0; i < ship_n; ++i) {
+	for(unsigned i = 0; i < world.ship_n; ++i) {
 		// TODO: this should be another system or something 
 			// and when it is activated it should get a input component
 			// and a collision component or something like that 
-		if(ships[i].inactive_timer <= 0) {
-			update_player_movement(ships[i]);
+		if(world.ships[i].inactive_timer <= 0) {
+			update_player_movement(world.ships[i]);
 		}
 	}
 }
 
 inline void system_forward_movement() {
-	for(unsigned i = 0; i < asteroid_n; ++i) {
-		Asteroid &s = asteroids[i];
-		update_position(s.position, s.velocity);
+	Asteroid *a = world.asteroids.data();
+	Batch::add(&a->position, &a->position, &a->velocity, world.asteroid_n, sizeof(Asteroid));
+	Bullet *b = world.bullets.data();
+	Batch::add(&b->position, &b->position, &b->velocity, world.bullets_n, sizeof(Bullet));
+}
+
+void system_keep_in_bounds() {
+	for(unsigned i = 0; i < world.asteroid_n; ++i) {
+		keep_in_bounds(world.asteroids[i].position);
 	}
-	for(unsigned i = 0; i < bullets_n; ++i) {
-		Bullet &s = bullets[i];
-		update_position(s.position, s.velocity);
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		keep_in_bounds(world.ships[i].position);
 	}
 }
 
-void system_keep_in_bounds() {
-	for(unsigned i = 0; i < asteroid_n; ++i) {
-		keep_in_bounds(asteroids[i].position);
+// Packed copies of circles for Batch::overlap_mask and sweep_mask. They grow with the world
+// and are kept, so a tick does not allocate.
+struct CollisionScratch {
+	std::vector<Vec2> centers;
+	std::vector<Vec2> velocities;
+	std::vector<Scalar> radii;
+	std::vector<uint64_t> hits;
+
+	void reserve(size_t n) {
+		n = std::max(n, (size_t)64);
+		if(centers.size() < n) {
+			centers.resize(n);
+			velocities.resize(n);
+			radii.resize(n);
+			hits.resize(Batch::mask_words(n));
+		}
 	}
-	for(unsigned i = 0; i < ship_n; ++i) {
-		keep_in_bounds(ships[i].position);
+};
+
+static CollisionScratch ship_scratch;
+static CollisionScratch asteroid_scratch;
+static CollisionScratch bullet_scratch;
+
+bool layers_collide(int a, int b) {
+	return (world.config.collision_masks[a] >> b & 1) && (world.config.collision_masks[b] >> a & 1);
+}
+
+// The circles of each layer this tick and how fast the fastest moves, |x| + |y|
+struct CollisionLayers {
+	CollisionScratch *circles[LAYER_COUNT] = { &ship_scratch, &asteroid_scratch, &bullet_scratch };
+	unsigned n[LAYER_COUNT];
+	Scalar max_speed[LAYER_COUNT];
+	// pairs that touched, slot in the first layer << 32 | slot in the second,
+	// sorted. Filled for the pairs of layers handled as lists.
+	std::vector<uint64_t> pairs[LAYER_COUNT][LAYER_COUNT];
+};
+
+static CollisionLayers collision_layers;
+
+// Room in every pair list for each body of the larger layer touching one of
+// the other, so ticks do not grow them. Called by game_state_reset, a pileup
+// past that still grows them.
+void collision_layers_reserve() {
+	size_t capacity[LAYER_COUNT];
+	capacity[LAYER_SHIP] = world.ships.size();
+	capacity[LAYER_ASTEROID] = world.asteroids.size();
+	capacity[LAYER_BULLET] = world.bullets.size();
+	for(int la = 0; la < LAYER_COUNT; ++la) {
+		for(int lb = 0; lb <= la; ++lb) {
+			collision_layers.pairs[la][lb].reserve(std::max(capacity[la], capacity[lb]));
+		}
 	}
 }
 
-void system_collisions() {
-	for(unsigned ai = 0; ai < asteroid_n; ++ai) {
-		for(unsigned si = 0; si < ship_n; ++si) {
-			Position &pp = ships[si].position;
-			float pr = ships[si].radius;
-			Position &ap = asteroids[ai].position;
-			float ar = asteroids[ai].radius();
-			if(Math::intersect_circles(pp.x, pp.y, pr, ap.x, ap.y, ar)) {
-				queue_event({ Event::ShipHit, new ShipHitData { ships[si].faction }});
+// Pairs involving bullets are swept over the tick, the rest overlap at its end
+inline bool layers_swept(int a, int b) {
+	return a == LAYER_BULLET || b == LAYER_BULLET;
+}
+
+inline bool pair_touches(int la, unsigned a, int lb, unsigned b) {
+	const CollisionScratch &ca = *collision_layers.circles[la];
+	const CollisionScratch &cb = *collision_layers.circles[lb];
+	if(layers_swept(la, lb)) {
+		return Math::sweep_circles(ca.centers[a], ca.velocities[a], ca.radii[a], cb.centers[b], cb.velocities[b], cb.radii[b]);
+	}
+	return Math::intersect_circles(ca.centers[a], ca.radii[a], cb.centers[b], cb.radii[b]);
+}
+
+// Rules past the layers: a bullet spares its own faction and ships waiting
+// to respawn, a ship is not tested against itself
+inline bool pair_allowed(int la, unsigned a, int lb, unsigned b) {
+	if(la == LAYER_BULLET && lb == LAYER_SHIP) {
+		return world.bullets[a].faction != world.ships[b].faction && world.ships[b].inactive_timer <= 0;
+	}
+	return la != lb || a > b;
+}
+
+// Narrow phase of ships against the pixels of their sprite, for pairs whose
+// circles touched. Ship circles are grown to hold the sprite, the others are
+// circle masks of their radius. Masks are centered on the pixel corner at
+// the floor of the position, as sprites are drawn.
+namespace PixelCollisions {
+	const int SHIP_ROTATIONS = 32;
+
+	// ship.png masks, set by asteroids_load. Headless tools that turn
+	// pixel_collisions on, or play back a world that has it on, have to
+	// provide them too.
+	static const SpriteMasks *ship_masks = NULL;
+	// the masks ship_radius was worked out for
+	static const SpriteMasks *measured = NULL;
+	static float radius = 0.0f;
+	static std::vector<std::pair<Fixed, Bitmask::Mask>> circles;
+
+	inline bool enabled() {
+		return world.config.pixel_collisions && ship_masks != NULL;
+	}
+
+	// Whether the world asks for pixels and there are no masks. Playing on
+	// by circles would quietly differ from where it was recorded, so the
+	// tick is refused instead.
+	bool missing() {
+		if(!world.config.pixel_collisions || ship_masks != NULL) {
+			return false;
+		}
+		static bool reported = false;
+		if(!reported) {
+			printf("pixel_collisions is on and no ship masks are loaded, the simulation does not run\n");
+			reported = true;
+		}
+		ASSERT_WITH_MSG(false, "pixel_collisions is on and no ship masks are loaded");
+		return true;
+	}
+
+	const Bitmask::Mask &circle(Fixed radius) {
+		for(auto &c : circles) {
+			if(c.first == radius) {
+				return c.second;
 			}
 		}
+		circles.push_back({ radius, Bitmask::circle(radius) });
+		return circles.back().second;
 	}
 
-	for(unsigned bi = 0; bi < bullets_n; ++bi) {
-		for(unsigned ai = 0; ai < asteroid_n; ++ai) {
-			Position &bp = bullets[bi].position;
-			float br = bullets[bi].radius;
-			Position &ap = asteroids[ai].position;
-			float ar = asteroids[ai].radius();
-			if(Math::intersect_circles(bp.x, bp.y, br, ap.x, ap.y, ar)) {
-				queue_event({ Event::AsteroidDestroyed, new AsteroidDestroyedData { 
-					asteroids[ai].size,
-					bullets[bi].faction
-				}});
-				
-				Velocity v = { asteroids[ai].velocity.x * 3, asteroids[ai].velocity.y * 3 };
-				int size = asteroids[ai].size + 1;
-				queue_event({ Event::SpawnAsteroid, new AsteroidSpawnData { ap, v, size } });
-				v.x = -v.x;
-				v.y = -v.y;
-				queue_event({ Event::SpawnAsteroid, new AsteroidSpawnData { ap, v, size } });
-				
-				// TODO: This should be an destroy entity event and just send the ID
-				bullets[bi].time_to_live = 0.0f;
-
-				// TODO: This should be an destroy entity event and just send the ID
-				// then some system could watch for destroyed asteroids and spawn new ones if needed
-				// probably a part of the Event::AsteroidDestroyed
-				asteroids[ai] = asteroids[asteroid_n - 1];
-				asteroid_n--;
+	// Radius of the ship circle, so it holds every rotation
+	float ship_radius(const Ship &ship) {
+		if(!enabled()) {
+			return ship.radius;
+		}
+		if(measured != ship_masks) {
+			measured = ship_masks;
+			radius = 0.0f;
+			for(const Bitmask::Mask &mask : ship_masks->rotations) {
+				radius = std::max(radius, mask.radius);
 			}
-		}	
+		}
+		return std::max(ship.radius, radius);
+	}
+
+	// The rotation closest to how the ship is drawn, at angle + 90
+	const Bitmask::Mask &ship_mask(const Ship &ship) {
+		int n = (int)ship_masks->rotations.size();
+#ifdef ASTEROIDS_FIXED_POINT
+		// rounded to the nearest of n in integers, no float on the way
+		int64_t turn = 720LL * Fixed::ONE;
+		int64_t v = ((int64_t)ship.angle.raw + 90LL * Fixed::ONE) * n * 2 + turn / 2;
+		int i = (int)((v / turn - (v % turn < 0 ? 1 : 0)) % n);
+#else
+		int i = (int)std::floor((ship.angle + 90.0f) * n / 360.0f + 0.5f) % n;
+#endif
+		return ship_masks->rotations[i < 0 ? i + n : i];
+	}
+
+	inline int floor_int(Scalar value) {
+#ifdef ASTEROIDS_FIXED_POINT
+		return value.raw >> Fixed::FRACTION_BITS;
+#else
+		return (int)std::floor(value);
+#endif
+	}
+	inline int left(Vec2 center, const Bitmask::Mask &mask) {
+		return floor_int(center.x) - mask.w / 2;
+	}
+	inline int top(Vec2 center, const Bitmask::Mask &mask) {
+		return floor_int(center.y) - mask.h / 2;
+	}
+
+	bool touch(const Bitmask::Mask &a, Vec2 a_center, const Bitmask::Mask &b, Vec2 b_center) {
+		return Bitmask::overlap(a, left(a_center, a), top(a_center, a), b, left(b_center, b), top(b_center, b));
+	}
+
+	// Whether a pair of slots whose circles touched touches pixel wise. A
+	// bullet is tested where it came closest to the ship over the tick.
+	bool pair_touches(int la, unsigned a, int lb, unsigned b) {
+		if(!enabled() || lb != LAYER_SHIP) {
+			return true;
+		}
+		const Ship &ship = world.ships[b];
+		if(la == LAYER_SHIP) {
+			return touch(ship_mask(world.ships[a]), world.ships[a].position, ship_mask(ship), ship.position);
+		}
+		const CollisionScratch &other = *collision_layers.circles[la];
+		Vec2 center = other.centers[a];
+		Vec2 ship_center = ship.position;
+		if(la == LAYER_BULLET) {
+			Vec2 velocity = other.velocities[a];
+			Scalar back = Math::sweep_closest(ship_center - center, ship.velocity - velocity);
+			center -= velocity * back;
+			ship_center -= ship.velocity * back;
+		}
+		return touch(circle(Fixed(other.radii[a])), center, ship_mask(ship), ship_center);
+	}
+}
+
+// Sort and sweep along x. Each layer keeps its own list of spans sorted by
+// their left end, kept from tick to tick so insertion sort only has to move
+// the few bodies that passed each other. Walking two lists side by side gives
+// every pair of bodies of the two layers whose spans overlap.
+namespace Broadphase {
+	// In batch tests of all pairs, what the sweep pays for the exact test of
+	// a candidate pair and for updating and sorting a body. Measured with
+	// bench sim/collisions_spread_*.
+	const float PAIR_COST = 10.0f;
+	const float BODY_COST = 10.0f;
+
+	// x extent of a body over the tick, index is its slot
+	struct Span {
+		Scalar min;
+		Scalar max;
+		unsigned index;
+	};
+
+	struct Axis {
+		std::vector<Span> spans;
+		// tick the order was last kept up, past that it is sorted from scratch
+		uint32_t sorted_tick = 0;
+	};
+
+	struct State {
+		uint32_t tick = 0;
+		Axis axes[LAYER_COUNT];
+		std::vector<unsigned> bullets_hitting;
+		std::vector<uint8_t> hit;
+		bool used_sweep = false;
+	};
+
+	static State state;
+
+	inline bool span_less(const Span &a, const Span &b) {
+		return a.min < b.min;
+	}
+
+	// Brings the spans of n circles up to date and sorted. They cover where
+	// the circles were at the start of the tick too, and a pixel is added on
+	// both sides so rounding cannot drop a pair the exact test would find.
+	void update(Axis &axis, const CollisionScratch &circles, unsigned n) {
+		std::vector<Span> &spans = axis.spans;
+		unsigned kept = 0;
+		for(unsigned i = 0; i < spans.size(); ++i) {
+			if(spans[i].index < n) {
+				spans[kept++] = spans[i];
+			}
+		}
+		spans.resize(kept);
+		for(unsigned i = kept; i < n; ++i) {
+			spans.push_back({ 0, 0, i });
+		}
+		for(Span &span : spans) {
+			Scalar x = circles.centers[span.index].x;
+			Scalar start = x - circles.velocities[span.index].x;
+			Scalar r = circles.radii[span.index] + Scalar(1);
+			span.min = std::min(x, start) - r;
+			span.max = std::max(x, start) + r;
+		}
+		// Slots refilled by swap-removes hold a body from anywhere, after a
+		// lot of them insertion sort gives up and sorts from scratch
+		bool sorted = axis.sorted_tick + 1 == state.tick;
+		size_t moves_left = 8 * spans.size() + 64;
+		for(unsigned i = 1; sorted && i < spans.size(); ++i) {
+			Span span = spans[i];
+			unsigned j = i;
+			for(; j > 0 && span.min < spans[j - 1].min; --j) {
+				spans[j] = spans[j - 1];
+			}
+			spans[j] = span;
+			moves_left -= std::min<size_t>(moves_left, i - j);
+			sorted = moves_left > 0;
+		}
+		if(!sorted) {
+			std::sort(spans.begin(), spans.end(), span_less);
+		}
+		axis.sorted_tick = state.tick;
+	}
+
+	// Calls pair(index in a, index in b) for every overlap of the spans of a
+	// and b, once each. With a and b the same list every overlap of two
+	// different spans, once.
+	template<typename F>
+	void overlaps(const Axis &a, const Axis &b, F pair) {
+		const std::vector<Span> &as = a.spans;
+		const std::vector<Span> &bs = b.spans;
+		if(&a == &b) {
+			for(unsigned i = 0; i < as.size(); ++i) {
+				for(unsigned k = i + 1; k < as.size() && as[k].min <= as[i].max; ++k) {
+					pair(as[i].index, as[k].index);
+				}
+			}
+			return;
+		}
+		unsigned i = 0, j = 0;
+		while(i < as.size() && j < bs.size()) {
+			if(as[i].min <= bs[j].min) {
+				for(unsigned k = j; k < bs.size() && bs[k].min <= as[i].max; ++k) {
+					pair(as[i].index, bs[k].index);
+				}
+				i++;
+			} else {
+				for(unsigned k = i; k < as.size() && as[k].min <= bs[j].max; ++k) {
+					pair(as[k].index, bs[j].index);
+				}
+				j++;
+			}
+		}
+	}
+
+	// Sum of the widths the spans of n circles will have
+	float width(const CollisionScratch &circles, unsigned n) {
+		float sum = 0.0f;
+		for(unsigned i = 0; i < n; ++i) {
+			sum += 2.0f * (float)circles.radii[i] + 2.0f + std::fabs((float)circles.velocities[i].x);
+		}
+		return sum;
+	}
+
+	// Whether this tick sweeps, from the counts and how much of the field
+	// width the bodies cover. Per pair of layers tested the expected overlaps
+	// on x are the pairs times the share of the field width two spans cover.
+	// Only the layers in a tested pair get spans, only while sweeping.
+	bool choose(const bool tested[LAYER_COUNT][LAYER_COUNT]) {
+		State &s = state;
+		s.tick++;
+		const CollisionLayers &layers = collision_layers;
+		bool used[LAYER_COUNT] = {};
+		for(int la = 0; la < LAYER_COUNT; ++la) {
+			for(int lb = 0; lb <= la; ++lb) {
+				used[la] |= tested[la][lb];
+				used[lb] |= tested[la][lb];
+			}
+		}
+		s.used_sweep = world.config.broadphase == BROADPHASE_SWEEP;
+		if(world.config.broadphase == BROADPHASE_AUTO) {
+			float pairs = 0.0f;
+			float sweep = 0.0f;
+			for(int la = 0; la < LAYER_COUNT; ++la) {
+				sweep += used[la] ? BODY_COST * layers.n[la] : 0.0f;
+				for(int lb = 0; lb <= la; ++lb) {
+					pairs += tested[la][lb] ? (float)layers.n[la] * layers.n[lb] : 0.0f;
+				}
+			}
+			// too few pairs to be worth measuring
+			if(sweep < pairs) {
+				float average[LAYER_COUNT];
+				for(int l = 0; l < LAYER_COUNT; ++l) {
+					average[l] = used[l] && layers.n[l] > 0 ? width(*layers.circles[l], layers.n[l]) / layers.n[l] : 0.0f;
+				}
+				for(int la = 0; la < LAYER_COUNT; ++la) {
+					for(int lb = 0; lb <= la; ++lb) {
+						if(tested[la][lb]) {
+							float share = std::min(1.0f, (average[la] + average[lb]) / gw);
+							sweep += PAIR_COST * (float)layers.n[la] * layers.n[lb] * share;
+						}
+					}
+				}
+				s.used_sweep = sweep < pairs;
+			}
+		}
+		if(s.used_sweep) {
+			for(int l = 0; l < LAYER_COUNT; ++l) {
+				if(used[l]) {
+					update(s.axes[l], *layers.circles[l], layers.n[l]);
+				}
+			}
+		}
+		return s.used_sweep;
+	}
+
+	// Pairs of layers la and lb that touch, into the pair list
+	void find_pairs(int la, int lb) {
+		std::vector<uint64_t> &pairs = collision_layers.pairs[la][lb];
+		overlaps(state.axes[la], state.axes[lb], [&](unsigned a, unsigned b) {
+			if(la == lb && a < b) {
+				std::swap(a, b);
+			}
+			if(pair_allowed(la, a, lb, b) && pair_touches(la, a, lb, b) && PixelCollisions::pair_touches(la, a, lb, b)) {
+				pairs.push_back((uint64_t)a << 32 | b);
+			}
+		});
+		std::sort(pairs.begin(), pairs.end());
+	}
+
+	// Bullets whose sweep touches an asteroid, in index order
+	const std::vector<unsigned> &bullets_hitting(const CollisionScratch &bullets, const CollisionScratch &asteroids) {
+		State &s = state;
+		s.hit.resize(std::max(s.hit.size(), (size_t)world.bullets_n));
+		s.bullets_hitting.clear();
+		overlaps(s.axes[LAYER_ASTEROID], s.axes[LAYER_BULLET], [&](unsigned ai, unsigned bi) {
+			if(!s.hit[bi] && Math::sweep_circles(bullets.centers[bi], bullets.velocities[bi], bullets.radii[bi], asteroids.centers[ai], asteroids.velocities[ai], asteroids.radii[ai])) {
+				s.hit[bi] = 1;
+				s.bullets_hitting.push_back(bi);
+			}
+		});
+		std::sort(s.bullets_hitting.begin(), s.bullets_hitting.end());
+		for(unsigned bi : s.bullets_hitting) {
+			s.hit[bi] = 0;
+		}
+		return s.bullets_hitting;
+	}
+}
+
+// Pairs of layers la and lb that touch, each body of la tested against all of
+// lb at once
+void find_pairs_batched(int la, int lb) {
+	CollisionLayers &layers = collision_layers;
+	const CollisionScratch &ca = *layers.circles[la];
+	CollisionScratch &cb = *layers.circles[lb];
+	std::vector<uint64_t> &pairs = layers.pairs[la][lb];
+	unsigned n = layers.n[lb];
+	for(unsigned a = 0; a < layers.n[la]; ++a) {
+		if(layers_swept(la, lb)) {
+			Batch::sweep_mask(cb.hits.data(), ca.centers[a], ca.velocities[a], ca.radii[a], cb.centers.data(), cb.velocities.data(), cb.radii.data(), layers.max_speed[lb], n);
+		} else {
+			Batch::overlap_mask(cb.hits.data(), ca.centers[a], ca.radii[a], cb.centers.data(), cb.radii.data(), n);
+		}
+		for(unsigned b = Batch::next_set(cb.hits.data(), 0, n); b < n; b = Batch::next_set(cb.hits.data(), b + 1, n)) {
+			if(pair_allowed(la, a, lb, b) && PixelCollisions::pair_touches(la, a, lb, b)) {
+				pairs.push_back((uint64_t)a << 32 | b);
+			}
+		}
+	}
+}
+
+int asteroid_score(int size) {
+	switch(size) {
+		case 1: return 10;
+		case 2: return 20;
+		case 3: return 50;
+	}
+	return 0;
+}
+
+// Queues the events of asteroid ai being shot by b and removes it, the last
+// asteroid takes its slot. The pieces start where it was hit within the tick.
+void asteroid_hit(Bullet &b, unsigned ai) {
+	Asteroid &a = world.asteroids[ai];
+	Scalar time = Math::time_of_impact(b.position, b.velocity, Scalar(b.radius), a.position, a.velocity, Scalar(a.radius()));
+	Vec2 ap = a.position - a.velocity * (Scalar(1) - time);
+	Event e;
+	e.type = Event::AsteroidDestroyed;
+	e.asteroid_destroyed = { world.asteroids[ai].size, b.faction, asteroid_score(world.asteroids[ai].size) };
+	queue_event(e);
+	
+	Vec2 v = world.asteroids[ai].velocity * 3;
+	int size = world.asteroids[ai].size + 1;
+	e.type = Event::SpawnAsteroid;
+	e.asteroid_spawn = { ap, v, size };
+	queue_event(e);
+	e.asteroid_spawn.velocity = -v;
+	queue_event(e);
+	
+	// TODO: This should be an destroy entity event and just send the ID
+	b.time_to_live = 0.0f;
+
+	// TODO: This should be an destroy entity event and just send the ID
+	// then some system could watch for destroyed asteroids and spawn new ones if needed
+	// probably a part of the Event::AsteroidDestroyed
+	world.asteroid_n--;
+	world.asteroids[ai] = world.asteroids[world.asteroid_n];
+}
+
+// Tests one bullet against all asteroids at once. A hit moves the last
+// asteroid into its slot and the search goes on after it, so that asteroid is
+// not tested against this bullet.
+void bullet_collisions(Bullet &b, CollisionScratch &asteroids, Scalar max_speed) {
+	Batch::sweep_mask(asteroids.hits.data(), b.position, b.velocity, Scalar(b.radius), asteroids.centers.data(), asteroids.velocities.data(), asteroids.radii.data(), max_speed, world.asteroid_n);
+	for(unsigned ai = Batch::next_set(asteroids.hits.data(), 0, world.asteroid_n); ai < world.asteroid_n; ai = Batch::next_set(asteroids.hits.data(), ai + 1, world.asteroid_n)) {
+		asteroid_hit(b, ai);
+		asteroids.centers[ai] = asteroids.centers[world.asteroid_n];
+		asteroids.velocities[ai] = asteroids.velocities[world.asteroid_n];
+		asteroids.radii[ai] = asteroids.radii[world.asteroid_n];
+	}
+}
+
+void ship_hit(unsigned si) {
+	// nothing in handle_events changes these, it would skip the hit anyway
+	// and a ship sitting in an asteroid would queue one every tick
+	if(world.ships[si].inactive_timer > 0 || world.ships[si].shield.is_active()) {
+		return;
+	}
+	Event e;
+	e.type = Event::ShipHit;
+	e.ship_hit = { world.ships[si].faction };
+	queue_event(e);
+}
+
+// Gathers the circles of a layer and the speed of its fastest
+template<typename T, typename F>
+void gather_layer(int layer, const std::vector<T> &entities, unsigned n, F radius) {
+	CollisionScratch &circles = *collision_layers.circles[layer];
+	circles.reserve(n);
+	Scalar max_speed = 0;
+	for(unsigned i = 0; i < n; ++i) {
+		Vec2 v = entities[i].velocity;
+		circles.centers[i] = entities[i].position;
+		circles.velocities[i] = v;
+		circles.radii[i] = radius(entities[i]);
+		max_speed = std::max(max_speed, Math::abs(v.x) + Math::abs(v.y));
+	}
+	collision_layers.n[layer] = n;
+	collision_layers.max_speed[layer] = max_speed;
+}
+
+// Only the pairs of layers world.config.collision_masks enables are tested,
+// each circle against all circles of the other layer at once, or only against
+// the ones the broadphase finds. Both give the same events in the same order.
+// Bullets and asteroids are handled one bullet at a time as hits remove
+// asteroids, the other pairs of layers are found into pair lists first.
+void system_collisions() {
+	CollisionLayers &layers = collision_layers;
+	gather_layer(LAYER_SHIP, world.ships, world.ship_n, [](const Ship &s) { return Scalar(PixelCollisions::ship_radius(s)); });
+	gather_layer(LAYER_ASTEROID, world.asteroids, world.asteroid_n, [](Asteroid a) { return Scalar(a.radius()); });
+	gather_layer(LAYER_BULLET, world.bullets, world.bullets_n, [](const Bullet &b) { return Scalar(b.radius); });
+	CollisionScratch &asteroids = asteroid_scratch;
+	CollisionScratch &bullets = bullet_scratch;
+
+	bool tested[LAYER_COUNT][LAYER_COUNT] = {};
+	for(int la = 0; la < LAYER_COUNT; ++la) {
+		for(int lb = 0; lb <= la; ++lb) {
+			tested[la][lb] = layers_collide(la, lb);
+			layers.pairs[la][lb].clear();
+		}
+	}
+	bool sweep = Broadphase::choose(tested);
+	for(int la = 0; la < LAYER_COUNT; ++la) {
+		for(int lb = 0; lb <= la; ++lb) {
+			if(tested[la][lb] && !(la == LAYER_BULLET && lb == LAYER_ASTEROID)) {
+				if(sweep) {
+					Broadphase::find_pairs(la, lb);
+				} else {
+					find_pairs_batched(la, lb);
+				}
+			}
+		}
+	}
+
+	for(uint64_t pair : layers.pairs[LAYER_ASTEROID][LAYER_SHIP]) {
+		ship_hit((uint32_t)pair);
+	}
+
+	// Bullets are swept over the tick, from position - velocity to position,
+	// so they hit small asteroids however far they move in a tick
+	if(tested[LAYER_BULLET][LAYER_ASTEROID] && sweep) {
+		for(unsigned bi : Broadphase::bullets_hitting(bullets, asteroids)) {
+			bullet_collisions(world.bullets[bi], asteroids, layers.max_speed[LAYER_ASTEROID]);
+		}
+	} else if(tested[LAYER_BULLET][LAYER_ASTEROID]) {
+		for(unsigned bi = 0; bi < world.bullets_n; ++bi) {
+			bullet_collisions(world.bullets[bi], asteroids, layers.max_speed[LAYER_ASTEROID]);
+		}
+	}
+
+	// a bullet is spent on the first ship it hits, or on an asteroid above
+	for(uint64_t pair : layers.pairs[LAYER_BULLET][LAYER_SHIP]) {
+		Bullet &b = world.bullets[pair >> 32];
+		if(b.time_to_live > 0.0f) {
+			b.time_to_live = 0.0f;
+			ship_hit((uint32_t)pair);
+		}
+	}
+	for(uint64_t pair : layers.pairs[LAYER_SHIP][LAYER_SHIP]) {
+		ship_hit(pair >> 32);
+		ship_hit((uint32_t)pair);
 	}
 }
 
 inline void bullet_cleanup() {
-	for(unsigned i = 0; i < bullets_n; ++i) {
-		Bullet &b = bullets[i];
-		Position &p = bullets[i].position;
+	for(unsigned i = 0; i < world.bullets_n; ++i) {
+		Bullet &b = world.bullets[i];
+		Vec2 &p = world.bullets[i].position;
 		b.time_to_live -= Time::delta_time;
 
 		if(p.x < 0 || p.y < 0 || p.x > gw || p.y > gh 
 			|| b.time_to_live <= 0.0f 
-			|| ship_n == 0) {
+			|| world.ship_n == 0) {
             
 			// TODO: This should be an destroy entity event and just send the ID
-			bullets[i] = bullets[bullets_n - 1];
-			bullets_n--;
+			world.bullets[i] = world.bullets[world.bullets_n - 1];
+			world.bullets_n--;
+		}
+	}
+}
+
+// Reorders asteroids and bullets by the 16 px strip along x they are in, the
+// axis Broadphase sweeps, so the sweep and the tests of its pairs read the
+// entity and scratch arrays front to back. Swap-removes and spawns leave
+// bodies out of place, an array is sorted again once a third of neighbours are.
+// Nothing keeps a slot from one tick to the next, only the broadphase spans,
+// which are moved to the new slots.
+namespace SpatialOrder {
+	const int STRIP = 16;
+	const unsigned DISORDER = 3;
+
+	static std::vector<uint64_t> keys;
+	static std::vector<unsigned> moved_to;
+	static std::vector<Asteroid> asteroids;
+	static std::vector<Bullet> bullets;
+
+	inline uint32_t strip(Vec2 p) {
+		return (uint32_t)std::max(PixelCollisions::floor_int(p.x) / STRIP, 0);
+	}
+
+	// Room for full arrays, so sorting does not allocate during a tick
+	void reserve() {
+		size_t n = std::max(world.asteroids.size(), world.bullets.size());
+		keys.reserve(n);
+		moved_to.reserve(n);
+		asteroids.reserve(world.asteroids.size());
+		bullets.reserve(world.bullets.size());
+	}
+
+	// The spans keep their x order at the new slots. Slots the broadphase has
+	// not seen yet get a span, so they still cover the first n slots.
+	void remap(Broadphase::Axis &axis, unsigned n) {
+		std::vector<Broadphase::Span> &spans = axis.spans;
+		if(spans.empty()) {
+			return;
+		}
+		unsigned listed = std::min((unsigned)spans.size(), n);
+		unsigned kept = 0;
+		for(unsigned i = 0; i < spans.size(); ++i) {
+			if(spans[i].index < n) {
+				Broadphase::Span span = spans[i];
+				span.index = moved_to[span.index];
+				spans[kept++] = span;
+			}
+		}
+		spans.resize(kept);
+		for(unsigned i = listed; i < n; ++i) {
+			spans.push_back({ 0, 0, moved_to[i] });
 		}
 	}
+
+	// Bodies in the same strip keep their order
+	template<typename T>
+	void sort(std::vector<T> &entities, unsigned n, std::vector<T> &sorted, Broadphase::Axis &axis) {
+		unsigned out_of_place = 0;
+		for(unsigned i = 1; i < n; ++i) {
+			out_of_place += strip(entities[i].position) < strip(entities[i - 1].position) ? 1 : 0;
+		}
+		if(out_of_place * DISORDER <= n) {
+			return;
+		}
+		keys.resize(n);
+		for(unsigned i = 0; i < n; ++i) {
+			keys[i] = (uint64_t)strip(entities[i].position) << 32 | i;
+		}
+		std::sort(keys.begin(), keys.end());
+		sorted.resize(n);
+		moved_to.resize(n);
+		for(unsigned i = 0; i < n; ++i) {
+			sorted[i] = entities[(uint32_t)keys[i]];
+			moved_to[(uint32_t)keys[i]] = i;
+		}
+		std::copy(sorted.begin(), sorted.end(), entities.begin());
+		remap(axis, n);
+	}
 }
 
-void queue_event(Event e) {
-	ASSERT_WITH_MSG(event_n < event_queue.size(), "Too many events!");
-	event_queue[event_n++] = e;
+void system_spatial_order() {
+	if(!world.config.spatial_order) {
+		return;
+	}
+	SpatialOrder::sort(world.asteroids, world.asteroid_n, SpatialOrder::asteroids, Broadphase::state.axes[LAYER_ASTEROID]);
+	SpatialOrder::sort(world.bullets, world.bullets_n, SpatialOrder::bullets, Broadphase::state.axes[LAYER_BULLET]);
+}
+
+// Merging of events queued for the same target in a tick, by the rules in
+// world.config.event_merge. The first event of a (type, target) is found
+// through slots, which point into the queue and are checked against it, so
+// they need no clearing between ticks or after world_restore.
+namespace Events {
+	static const int TYPE_COUNT = Event::ShipHit + 1;
+
+	struct Counters {
+		// queue_event calls, and those merged into an earlier event
+		uint64_t raised[TYPE_COUNT] = {};
+		uint64_t merged[TYPE_COUNT] = {};
+	};
+
+	// Since the program started, ticks run again by a rollback count again
+	static Counters counters;
+	// queue index + 1 of the event for a target, by type and target
+	static std::vector<unsigned> slots[TYPE_COUNT];
+
+	// The faction an event is for, -1 for types that are never merged
+	inline int target(const Event &e) {
+		switch(e.type) {
+			case Event::AsteroidDestroyed: return e.asteroid_destroyed.faction;
+			case Event::ShipHit: return e.ship_hit.faction;
+			default: return -1;
+		}
+	}
+
+	// Room for every faction a game with this config can have, so the tick
+	// never grows them. Called by game_state_reset and world_restore.
+	void size_slots(const AsteroidsConfig &config) {
+		int highest = std::max(std::max(config.player_faction_1, config.player_faction_2), config.enemy_faction + std::max(config.bot_count, 0));
+		for(std::vector<unsigned> &slot : slots) {
+			if(slot.size() < (size_t)highest + 1) {
+				slot.resize(highest + 1, 0);
+			}
+		}
+	}
+
+	// The queued event e merges into, NULL when there is none
+	Event *find(const Event &e, int t) {
+		unsigned i = slots[e.type][t];
+		if(i == 0 || i > world.event_n) {
+			return NULL;
+		}
+		Event &queued = world.event_queue[i - 1];
+		return queued.type == e.type && target(queued) == t ? &queued : NULL;
+	}
+
+	// Whether e went into an earlier event instead of the queue
+	bool merge(const Event &e) {
+		int rule = world.config.event_merge[e.type];
+		int t = target(e);
+		if(rule == EVENT_MERGE_NONE || t < 0) {
+			return false;
+		}
+		if((unsigned)t >= slots[e.type].size()) {
+			ASSERT_WITH_MSG(false, "Event for faction " << t << " past the merge slots, size_slots not called");
+			return false;
+		}
+		Event *queued = find(e, t);
+		if(queued == NULL) {
+			slots[e.type][t] = world.event_n + 1;
+			return false;
+		}
+		if(rule == EVENT_MERGE_SUM && e.type == Event::AsteroidDestroyed) {
+			queued->asteroid_destroyed.score += e.asteroid_destroyed.score;
+		}
+		return true;
+	}
+}
+
+void queue_event(const Event &e) {
+	Events::counters.raised[e.type]++;
+	if(Events::merge(e)) {
+		Events::counters.merged[e.type]++;
+		return;
+	}
+	ASSERT_WITH_MSG(world.event_n < world.event_queue.size(), "Too many events!");
+	world.event_queue[world.event_n++] = e;
 }
 
 void handle_events() {
-	for(unsigned i = 0; i < event_n; ++i) {
-		Event &e = event_queue[i];
+	for(unsigned i = 0; i < world.event_n; ++i) {
+		Event &e = world.event_queue[i];
 		switch(e.type) {
 			case Event::FireBullet: {
-				ShotSpawnData *d = static_cast<ShotSpawnData*>(e.data);
+				ShotSpawnData *d = &e.shot_spawn;
 				spawn_bullet(d->position, d->rotation, d->faction, d->time_to_live);
-				delete d;
 				break;
 			}
 			case Event::SpawnAsteroid: {
-				AsteroidSpawnData *d = static_cast<AsteroidSpawnData*>(e.data);
+				AsteroidSpawnData *d = &e.asteroid_spawn;
 				if(d->size <= 3)
 					spawn_asteroid(d->position, d->velocity, d->size);
-				delete d;
 				break;
 			}
 			case Event::AsteroidDestroyed: {
-				AsteroidDestroyedData *d = static_cast<AsteroidDestroyedData*>(e.data);
-				int score = 0;
-				switch(d->size) {
-					case 1: score = 10; break;
-					case 2: score = 20; break;
-					case 3: score = 50; break;
-				}
+				AsteroidDestroyedData *d = &e.asteroid_destroyed;
 				// TODO: I don't think we should loop here
 				// should just be get the entity from id and do to that
-				for(unsigned si = 0; si < ship_n; ++si) {
-					if(ships[si].faction == d->faction) {
-						ships[si].score += score;
+				for(unsigned si = 0; si < world.ship_n; ++si) {
+					if(world.ships[si].faction == d->faction) {
+						world.ships[si].score += d->score;
 					}
 				}
-				delete d;
 				break;
 			}
 			case Event::ShipHit: {
 				// TODO: I don't think we should loop here
 				// should just be get the entity from id and do to that
-				ShipHitData *d = static_cast<ShipHitData*>(e.data);
-				for(unsigned si = 0; si < ship_n; ++si) {
-					if(ships[si].faction != d->faction || ships[si].inactive_timer > 0)
+				ShipHitData *d = &e.ship_hit;
+				for(unsigned si = 0; si < world.ship_n; ++si) {
+					if(world.ships[si].faction != d->faction || world.ships[si].inactive_timer > 0)
 						continue;
 
-					if(ships[i].shield.is_active()) {
+					if(world.ships[si].shield.is_active()) {
 						continue;
 					}
 
-					ships[si].inactive_timer = config.player_death_inactive_time;
-					ships[si].health--;
-					ships[si].position.x = gw / 2.0f;
-					ships[si].position.y = gh / 2.0f;
-					ships[si].angle = 0;
-					ships[si].velocity.x = ships[si].velocity.y = 0;
-					if(ships[si].health <= 0) {
-						ships[si] = ships[ship_n - 1];
-						ship_n--;
-						if(ship_n <= 0) {
+					world.ships[si].inactive_timer = world.config.player_death_inactive_time;
+					world.ships[si].health--;
+					world.ships[si].position = ship_spawn_position(world.ships[si].faction);
+					world.ships[si].angle = 0;
+					world.ships[si].velocity = { 0, 0 };
+					if(world.ships[si].health <= 0) {
+						world.ships[si] = world.ships[world.ship_n - 1];
+						world.ship_n--;
+						if(world.ship_n <= 0) {
 							game_state_inactivate();
 						}
 					}
 				}
-				delete d;
 			}
 		}
 	}
 
-	event_n = 0;
+	world.event_n = 0;
 }
 
 void game_state_reset() {
-	spawn_player(config.player_faction_1);
-	spawn_player(config.player_faction_2);
-	game_state.level = 1;
+	Events::size_slots(world.config);
+	collision_layers_reserve();
+	if(world.config.spatial_order) {
+		SpatialOrder::reserve();
+	}
+	if(world.config.player_count > 0)
+		spawn_player(world.config.player_faction_1);
+	if(world.config.player_count > 1)
+		spawn_player(world.config.player_faction_2);
+	for(int i = 0; i < world.config.bot_count; ++i) {
+		spawn_ship(world.config.enemy_faction + 1 + i, world.config.bot_pilot);
+	}
+	world.game_state.level = 1;
 	spawn_asteroid_wave();
 }
 
 void game_state_inactivate() {
-	game_state.inactive = true;
-	game_state.inactive_timer = game_state.pause_time;
+	world.game_state.inactive = true;
+	world.game_state.inactive_timer = world.game_state.pause_time;
+}
+
+
+// Starts a game from scratch, everything after this depends only on the seed
+// and the inputs given to asteroids_tick
+void asteroids_new_game(uint32_t seed) {
+	world.game_state = GameState();
+	world.game_state.rng.seed(seed);
+	world.ship_n = 0;
+	world.asteroid_n = 0;
+	world.bullets_n = 0;
+	world.event_n = 0;
+	game_state_reset();
+}
+
+inline void hash_scalar(Hash::Stream &h, Scalar value) {
+#ifdef ASTEROIDS_FIXED_POINT
+	h.add_i32(value.raw);
+#else
+	h.add_f32(value);
+#endif
+}
+
+// Hash of everything the simulation carries from one tick to the next,
+// two runs that agree on it every tick have not diverged
+uint64_t asteroids_state_hash() {
+	Hash::Stream h;
+	h.add_i32(world.game_state.inactive ? 1 : 0);
+	h.add_f32(world.game_state.inactive_timer);
+	h.add_i32(world.game_state.level);
+	h.add_u32(world.ship_n);
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		const Ship &s = world.ships[i];
+		hash_scalar(h, s.angle);
+		h.add_f32(s.radius);
+		h.add_i32(s.health);
+		h.add_i32(s.faction);
+		h.add_i32(s.score);
+		h.add_i32(s.pilot);
+		h.add_f32(s.inactive_timer);
+		h.add_f32(s.shield.active_timer);
+		h.add_f32(s.shield.inactive_timer);
+		h.add_f32(s.input.fire_cooldown);
+		hash_scalar(h, s.position.x);
+		hash_scalar(h, s.position.y);
+		hash_scalar(h, s.velocity.x);
+		hash_scalar(h, s.velocity.y);
+	}
+	h.add_u32(world.asteroid_n);
+	for(unsigned i = 0; i < world.asteroid_n; ++i) {
+		const Asteroid &a = world.asteroids[i];
+		h.add_i32(a.size);
+		hash_scalar(h, a.position.x);
+		hash_scalar(h, a.position.y);
+		hash_scalar(h, a.velocity.x);
+		hash_scalar(h, a.velocity.y);
+	}
+	h.add_u32(world.bullets_n);
+	for(unsigned i = 0; i < world.bullets_n; ++i) {
+		const Bullet &b = world.bullets[i];
+		h.add_i32(b.faction);
+		h.add_f32(b.time_to_live);
+		h.add_f32(b.radius);
+		hash_scalar(h, b.position.x);
+		hash_scalar(h, b.position.y);
+		hash_scalar(h, b.velocity.x);
+		hash_scalar(h, b.velocity.y);
+	}
+	return h.digest();
+}
+
+// Binary copy of a GameWorld, the buffer is sized for full entity arrays once
+// so saving and restoring never allocates
+struct WorldSnapshot {
+	std::vector<uint8_t> buffer;
+	size_t size = 0;
+};
+
+struct WorldSnapshotHeader {
+	GameState game_state;
+	AsteroidsConfig config;
+	unsigned ship_n;
+	unsigned asteroid_n;
+	unsigned bullets_n;
+	unsigned event_n;
+};
+
+static_assert(std::is_trivially_copyable<WorldSnapshotHeader>::value, "snapshot header is copied as bytes");
+static_assert(std::is_trivially_copyable<Ship>::value, "ships are copied as bytes");
+static_assert(std::is_trivially_copyable<Asteroid>::value, "asteroids are copied as bytes");
+static_assert(std::is_trivially_copyable<Bullet>::value, "bullets are copied as bytes");
+static_assert(std::is_trivially_copyable<Event>::value, "events are copied as bytes");
+
+void world_snapshot_init(WorldSnapshot &snapshot, const GameWorld &w = world) {
+	snapshot.buffer.resize(sizeof(WorldSnapshotHeader)
+		+ w.ships.size() * sizeof(Ship)
+		+ w.asteroids.size() * sizeof(Asteroid)
+		+ w.bullets.size() * sizeof(Bullet)
+		+ w.event_queue.size() * sizeof(Event));
+	snapshot.size = 0;
+}
+
+// Only the live part of each entity array is copied
+void world_save(WorldSnapshot &snapshot, const GameWorld &w = world) {
+	ASSERT_WITH_MSG(!snapshot.buffer.empty(), "world_snapshot_init not called");
+	uint8_t *out = snapshot.buffer.data();
+	WorldSnapshotHeader header = { w.game_state, w.config, w.ship_n, w.asteroid_n, w.bullets_n, w.event_n };
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+	memcpy(out, w.ships.data(), w.ship_n * sizeof(Ship));
+	out += w.ship_n * sizeof(Ship);
+	memcpy(out, w.asteroids.data(), w.asteroid_n * sizeof(Asteroid));
+	out += w.asteroid_n * sizeof(Asteroid);
+	memcpy(out, w.bullets.data(), w.bullets_n * sizeof(Bullet));
+	out += w.bullets_n * sizeof(Bullet);
+	memcpy(out, w.event_queue.data(), w.event_n * sizeof(Event));
+	out += w.event_n * sizeof(Event);
+	snapshot.size = out - snapshot.buffer.data();
 }
 
+void world_restore(const WorldSnapshot &snapshot, GameWorld &w = world) {
+	ASSERT_WITH_MSG(snapshot.size > 0, "restoring an empty snapshot");
+	const uint8_t *in = snapshot.buffer.data();
+	WorldSnapshotHeader header;
+	memcpy(&header, in, sizeof(header));
+	in += sizeof(header);
+	w.game_state = header.game_state;
+	w.config = header.config;
+	w.ship_n = header.ship_n;
+	w.asteroid_n = header.asteroid_n;
+	w.bullets_n = header.bullets_n;
+	w.event_n = header.event_n;
+	memcpy(w.ships.data(), in, w.ship_n * sizeof(Ship));
+	in += w.ship_n * sizeof(Ship);
+	memcpy(w.asteroids.data(), in, w.asteroid_n * sizeof(Asteroid));
+	in += w.asteroid_n * sizeof(Asteroid);
+	memcpy(w.bullets.data(), in, w.bullets_n * sizeof(Bullet));
+	in += w.bullets_n * sizeof(Bullet);
+	memcpy(w.event_queue.data(), in, w.event_n * sizeof(Event));
+	if(&w == &world) {
+		Events::size_slots(w.config);
+		if(w.config.spatial_order) {
+			SpatialOrder::reserve();
+		}
+	}
+}
 
 void asteroids_load() {
     Engine::set_base_data_folder("data");
-	Font *font = Resources::font_load("normal", "pixeltype.ttf", 15);
-	set_default_font(font);
-	Resources::font_load("gameover", "pixeltype.ttf", 85);
-
-	Resources::sprite_load("ship", "ship.png");
+	// packed assets are optional, loads fall back to the loose files
+	Startup::phase_begin("pack_mount");
+	Resources::pack_mount("assets.pak");
+	Startup::phase_end();
+
+	Startup::phase_begin("assets");
+	resources.font_normal = Resources::font_load_async("normal", "pixeltype.ttf", 15);
+	resources.font_gameover = Resources::font_load_async("gameover", "pixeltype.ttf", 85);
+	resources.ship = Resources::sprite_load_async("ship", "ship.png", PixelCollisions::SHIP_ROTATIONS);
+	Resources::load_wait();
+	PixelCollisions::ship_masks = Resources::sprite_masks(resources.ship);
+	Startup::phase_end();
+
+	set_default_font(Resources::font_get(resources.font_normal));
 	
 	// Resources::sprite_sheet_load("shooter", "shooter.data");
 
-	game_state_reset();
+	Startup::phase_begin("game_state_reset");
+	std::random_device seed;
+	asteroids_new_game(seed());
+	Startup::phase_end();
 }
 
-void asteroids_update() {
-    if(game_state.inactive) {
-		game_state.inactive_timer -= Time::delta_time;
+// Advances the simulation one tick, inputs are indexed by ship faction
+void asteroids_tick(const uint8_t *inputs) {
+	if(PixelCollisions::missing()) {
+		return;
+	}
+    if(world.game_state.inactive) {
+		world.game_state.inactive_timer -= Time::delta_time;
 		// Remove all asteroids and bullets, better do it here than special logic in event handling
-		event_n = 0;
-		asteroid_n = 0;
-		bullets_n = 0;
-		if(game_state.inactive_timer <= 0.0f) {
+		world.event_n = 0;
+		world.asteroid_n = 0;
+		world.bullets_n = 0;
+		if(world.game_state.inactive_timer <= 0.0f) {
 			game_state_reset();
-			game_state.inactive = false;
+			world.game_state.inactive = false;
 		}
 	}
 
 	system_asteroid_spawn();
 	system_shield();
-	system_player_input();
+	system_player_input(inputs);
 	system_player_movement();
 	system_forward_movement();
 	system_keep_in_bounds();
+	system_spatial_order();
 	system_collisions();
 
 	handle_events();
@@ -538,41 +1610,46 @@ void asteroids_update() {
 	bullet_cleanup();
 }
 
+void asteroids_update() {
+	uint8_t inputs[2] = { input_bits_from_keyboard(0), input_bits_from_keyboard(1) };
+	asteroids_tick(inputs);
+}
+
 void asteroids_render() {
 	renderer_clear();
 
 	draw_g_rectangle_filled_RGBA(0, 0, gw, gh, 34, 1, 46, 255);
 
-	if(game_state.inactive) {
-		int seconds = (int)game_state.inactive_timer;
-		draw_text_font_centered(Resources::font_get("gameover"), gw / 2, gh / 2, game_state.text_color, "GAME OVER");
-		draw_text_font_centered(Resources::font_get("normal"), gw / 2, gh / 2 + 100, game_state.text_color, 
-			std::string("Resetting in: " + std::to_string(seconds) + " seconds..").c_str());
+	if(world.game_state.inactive) {
+		int seconds = (int)world.game_state.inactive_timer;
+		draw_text_font_centered(Resources::font_get(resources.font_gameover), gw / 2, gh / 2, world.game_state.text_color, "GAME OVER");
+		draw_text_font_centered(Resources::font_get(resources.font_normal), gw / 2, gh / 2 + 100, world.game_state.text_color, 
+			Engine::frame_printf("Resetting in: %d seconds..", seconds));
 	} else {
-	    std::string level_string = "Level: " + std::to_string(game_state.level);
-	    draw_text_centered(gw / 2, gh - 10, game_state.text_color, level_string);
+	    const char *level_string = Engine::frame_printf("Level: %d", world.game_state.level);
+	    draw_text_centered(gw / 2, gh - 10, world.game_state.text_color, level_string);
     }
 
-	for(unsigned i = 0; i < asteroid_n; ++i) {
-		Position &p = asteroids[i].position;
-		int radius = (int16_t)asteroids[i].radius();
+	for(unsigned i = 0; i < world.asteroid_n; ++i) {
+		Vec2 &p = world.asteroids[i].position;
+		int radius = (int16_t)world.asteroids[i].radius();
 		draw_g_rectangle_filled_RGBA(
-			(int16_t)p.x - radius, 
-			(int16_t)p.y - radius,
+			(int16_t)(float)p.x - radius, 
+			(int16_t)(float)p.y - radius,
 			radius * 2,
 			radius * 2,
-			game_state.asteroid_color.r,
-			game_state.asteroid_color.g,
-			game_state.asteroid_color.b,
-			game_state.asteroid_color.a);
+			world.game_state.asteroid_color.r,
+			world.game_state.asteroid_color.g,
+			world.game_state.asteroid_color.b,
+			world.game_state.asteroid_color.a);
 	}
-	for(unsigned i = 0; i < bullets_n; ++i) {
-		Position &p = bullets[i].position;
+	for(unsigned i = 0; i < world.bullets_n; ++i) {
+		Vec2 &p = world.bullets[i].position;
 		SDL_Color c = { 255, 0, 0, 255 };
-		int radius = (int16_t)bullets[i].radius;
+		int radius = (int16_t)world.bullets[i].radius;
 		draw_g_rectangle_filled_RGBA(
-			(int16_t)p.x - radius, 
-			(int16_t)p.y - radius,
+			(int16_t)(float)p.x - radius, 
+			(int16_t)(float)p.y - radius,
 			radius * 2,
 			radius * 2,
 			c.r,
@@ -581,27 +1658,30 @@ void asteroids_render() {
 			c.a);
 	}
 
-	for(unsigned i = 0; i < ship_n; ++i) {
-		Ship &player = ships[i];
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		Ship &player = world.ships[i];
 
-		draw_sprite_centered_rotated(Resources::sprite_get("ship"), (int)player.position.x, (int)player.position.y, player.angle + 90);
+		draw_sprite_centered_rotated(Resources::sprite_get(resources.ship), (int)(float)player.position.x, (int)(float)player.position.y, (float)player.angle + 90);
 		
 		if(player.shield.is_active()) {
 			int shieldSize = 20;
-			draw_g_rectangle_RGBA((int16_t)player.position.x - shieldSize/2, 
-				(int16_t)player.position.y - shieldSize/2,
+			draw_g_rectangle_RGBA((int16_t)(float)player.position.x - shieldSize/2, 
+				(int16_t)(float)player.position.y - shieldSize/2,
 				shieldSize, shieldSize, 0,0,255,255);
 
 			//draw_g_circle_RGBA((int16_t)player.position.x, (int16_t)player.position.y, 10, 0, 0, 255, 255);
 		}
+		if(player.pilot != PILOT_PLAYER) {
+			continue;
+		}
+		int row = player.faction;
 		if(player.shield.inactive_timer <= 0) {
-			draw_g_rectangle_filled_RGBA(gw / 2 - 90, 11 + 10 * i, 5, 5, 0, 255, 0, 255);
+			draw_g_rectangle_filled_RGBA(gw / 2 - 90, 11 + 10 * row, 5, 5, 0, 255, 0, 255);
 		}
 		
-		std::string playerInfo = "Player " + std::to_string(player.faction + 1) + 
-			" | Lives: " + std::to_string(player.health) + " | Score: ";
-		draw_text(gw / 2 - 80, 10 + 10 * i, game_state.text_color, playerInfo);
-		draw_text(gw / 2 + 60, 10 + 10 * i, game_state.text_color, std::to_string(player.score));
+		const char *playerInfo = Engine::frame_printf("Player %d | Lives: %d | Score: ", player.faction + 1, player.health);
+		draw_text(gw / 2 - 80, 10 + 10 * row, world.game_state.text_color, playerInfo);
+		draw_text(gw / 2 + 60, 10 + 10 * row, world.game_state.text_color, Engine::frame_printf("%d", player.score));
 	}
 
 	renderer_draw_render_target();
@@ -0,0 +1,45 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <stdint.h>
+#include <vector>
+#include "fixed.h"
+
+// 1-bit collision masks. Each row is a run of 64-bit words, pixel x of a row
+// is bit x % 64 of word x / 64, so overlap tests AND 64 pixels at a time.
+// Masks are built with integer math and the Fixed sin table, so the same
+// sprite gives the same bits on every platform and pixel collisions keep to
+// the lockstep guarantee of the ASTEROIDS_FIXED_POINT build.
+namespace Bitmask {
+	struct Mask {
+		int w = 0;
+		int h = 0;
+		// words per row
+		int words = 0;
+		std::vector<uint64_t> bits;
+		// distance from the center to the furthest corner of a solid pixel
+		float radius = 0.0f;
+
+		bool get(int x, int y) const {
+			return (bits[y * words + x / 64] >> (x % 64)) & 1;
+		}
+	};
+
+	Mask make(int w, int h);
+	void set(Mask &mask, int x, int y);
+	// Pixels with alpha at or above threshold are solid, alpha is w * h bytes
+	Mask from_alpha(const uint8_t *alpha, int w, int h, uint8_t threshold = 128);
+	// A solid disc of the radius, centered in a square of side 2 * ceil(radius)
+	Mask circle(Fixed radius);
+	// The mask turned clockwise by degrees around its center, in a square of
+	// even side that holds any rotation. Nearest pixel, so it matches a sprite
+	// drawn rotated closely enough.
+	Mask rotated(const Mask &mask, Fixed degrees);
+	// Whether a with its top left corner at (ax, ay) and b at (bx, by) share a
+	// solid pixel
+	bool overlap(const Mask &a, int ax, int ay, const Mask &b, int bx, int by);
+	// Same, a pixel at a time, for comparison
+	bool overlap_pixels(const Mask &a, int ax, int ay, const Mask &b, int bx, int by);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <cstdint>
+
+// Q16.16 fixed point. Integer arithmetic gives the same bits with every
+// compiler, floating point setting and architecture, which float does not.
+// Range is about +-32767 with a resolution of 1/65536.
+// Right shifts of negative values are arithmetic on every compiler we use.
+struct Fixed {
+	static const int FRACTION_BITS = 16;
+	static const int32_t ONE = 1 << FRACTION_BITS;
+
+	int32_t raw;
+
+	Fixed() = default;
+	constexpr Fixed(int value) : raw(value * ONE) {}
+	constexpr Fixed(unsigned value) : raw((int32_t)value * ONE) {}
+	// truncates toward zero, exact for the float constants and inputs we use
+	Fixed(float value) : raw((int32_t)(value * (float)ONE)) {}
+
+	static constexpr Fixed from_raw(int32_t raw) {
+		Fixed f = Fixed();
+		f.raw = raw;
+		return f;
+	}
+	explicit operator float() const {
+		return raw * (1.0f / ONE);
+	}
+
+	Fixed &operator+=(Fixed b) { raw += b.raw; return *this; }
+	Fixed &operator-=(Fixed b) { raw -= b.raw; return *this; }
+	Fixed &operator*=(Fixed b) { raw = (int32_t)(((int64_t)raw * b.raw) >> FRACTION_BITS); return *this; }
+	Fixed &operator/=(Fixed b) { raw = (int32_t)(((int64_t)raw * ONE) / b.raw); return *this; }
+};
+
+inline Fixed operator+(Fixed a, Fixed b) { return a += b; }
+inline Fixed operator-(Fixed a, Fixed b) { return a -= b; }
+inline Fixed operator*(Fixed a, Fixed b) { return a *= b; }
+inline Fixed operator/(Fixed a, Fixed b) { return a /= b; }
+inline Fixed operator-(Fixed a) { return Fixed::from_raw(-a.raw); }
+inline bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+inline bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+inline bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+inline bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+inline bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+inline bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+namespace Math {
+	// Angles are in degrees like the float versions. A quarter wave table with
+	// linear interpolation, no libm involved.
+	Fixed sin_deg(Fixed degrees);
+	Fixed cos_deg(Fixed degrees);
+
+	// value in [0, max) by integer modulo
+	inline Fixed wrap(Fixed value, Fixed max) {
+		int32_t r = value.raw % max.raw;
+		return Fixed::from_raw(r < 0 ? r + max.raw : r);
+	}
+
+	// integer square root, rounded down
+	Fixed sqrt(Fixed value);
+
+	// squares in 64 bit, distances across the screen overflow Q16.16
+	inline bool intersect_circles(Fixed c1X, Fixed c1Y, Fixed c1Radius, Fixed c2X, Fixed c2Y, Fixed c2Radius) {
+		int64_t dx = (int64_t)c2X.raw - c1X.raw;
+		int64_t dy = (int64_t)c2Y.raw - c1Y.raw;
+		int64_t r = (int64_t)c1Radius.raw + c2Radius.raw;
+		return dx * dx + dy * dy < r * r;
+	}
+}
+
+#endif
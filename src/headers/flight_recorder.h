@@ -0,0 +1,213 @@
+// Flight recorder, game code included after replay.h.
+//
+// Keeps the inputs of the last SECONDS seconds in a ring and a world snapshot
+// every SNAPSHOT_SECONDS. When an assert fails or the game crashes the ring is
+// written as a replay file (see replay.h) that starts at the oldest snapshot
+// still covered by inputs and ends with the tick that failed, so
+// `replay verify` or `asteroids.exe --replay` reproduces it.
+// A tick costs one store, plus a world_save every SNAPSHOT_SECONDS, so it is
+// meant to be always on.
+// The dump runs from signal handlers, so it only uses memory and a file
+// opened by start and calls that are safe there (write, rename, unlink).
+#ifdef _WIN32
+	#include <io.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace FlightRecorder {
+	const int SECONDS = 30;
+	const int SNAPSHOT_SECONDS = 5;
+	const int TICKS = SECONDS * Replay::TICK_RATE;
+	const int SNAPSHOT_INTERVAL = SNAPSHOT_SECONDS * Replay::TICK_RATE;
+	const int SNAPSHOTS = SECONDS / SNAPSHOT_SECONDS + 1;
+
+	struct Keyframe {
+		uint32_t tick;
+		WorldSnapshot snapshot;
+	};
+
+	struct Recording {
+		bool enabled = false;
+		uint32_t tick = 0;
+		uint16_t inputs[TICKS];
+		Keyframe keyframes[SNAPSHOTS];
+		// runs of one keyframe are gathered here and written at once
+		Replay::Run runs[SNAPSHOT_INTERVAL];
+		// the dump goes to temp_path, opened by start, and is renamed to
+		// path so an older dump stays until a new one is complete
+		int file = -1;
+		char path[256];
+		char temp_path[260];
+	};
+
+	static Recording recording;
+
+	// Call before asteroids_tick with the inputs it gets
+	inline void record_tick(const uint8_t *inputs) {
+		Recording &r = recording;
+		if(!r.enabled) {
+			return;
+		}
+		if(r.tick % SNAPSHOT_INTERVAL == 0) {
+			Keyframe &k = r.keyframes[(r.tick / SNAPSHOT_INTERVAL) % SNAPSHOTS];
+			k.tick = r.tick;
+			world_save(k.snapshot);
+		}
+		r.inputs[r.tick % TICKS] = (uint16_t)(inputs[0] | inputs[1] << 8);
+		r.tick++;
+	}
+
+#ifdef _WIN32
+	inline int file_open(const char *path) {
+		return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+	}
+	inline bool file_write(int file, const void *data, size_t size) {
+		return _write(file, data, (unsigned)size) == (int)size;
+	}
+	inline void file_close(int file) {
+		_close(file);
+	}
+	inline void file_remove(const char *path) {
+		_unlink(path);
+	}
+#else
+	inline int file_open(const char *path) {
+		return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+	inline bool file_write(int file, const void *data, size_t size) {
+		const char *bytes = (const char*)data;
+		while(size > 0) {
+			ssize_t written = write(file, bytes, size);
+			if(written <= 0) {
+				return false;
+			}
+			bytes += written;
+			size -= (size_t)written;
+		}
+		return true;
+	}
+	inline void file_close(int file) {
+		close(file);
+	}
+	inline void file_remove(const char *path) {
+		unlink(path);
+	}
+#endif
+
+	// Writes the replay to the file opened by start, without allocating or
+	// stdio, it runs from a signal handler
+	bool dump() {
+		Recording &r = recording;
+		if(r.tick == 0 || r.file < 0) {
+			return false;
+		}
+		// the oldest snapshot whose inputs have not been overwritten
+		uint32_t last_keyframe = (r.tick - 1) / SNAPSHOT_INTERVAL * SNAPSHOT_INTERVAL;
+		uint32_t first_keyframe = last_keyframe;
+		while(first_keyframe >= (uint32_t)SNAPSHOT_INTERVAL
+			&& r.tick - (first_keyframe - SNAPSHOT_INTERVAL) <= (uint32_t)TICKS
+			&& last_keyframe - (first_keyframe - SNAPSHOT_INTERVAL) < (uint32_t)(SNAPSHOTS * SNAPSHOT_INTERVAL)) {
+			first_keyframe -= SNAPSHOT_INTERVAL;
+		}
+
+		Replay::Header header = { Replay::MAGIC, Replay::VERSION, 0, (uint32_t)SNAPSHOT_INTERVAL };
+		bool ok = file_write(r.file, &header, sizeof(header));
+		uint64_t offset = sizeof(header);
+
+		Replay::IndexEntry index[SNAPSHOTS];
+		uint32_t index_count = 0;
+		for(uint32_t first = first_keyframe; ok && first <= last_keyframe; first += SNAPSHOT_INTERVAL) {
+			const Keyframe &k = r.keyframes[(first / SNAPSHOT_INTERVAL) % SNAPSHOTS];
+			uint32_t tick_count = std::min(r.tick - first, (uint32_t)SNAPSHOT_INTERVAL);
+			uint32_t keyframe_size = (uint32_t)k.snapshot.size;
+			index[index_count++] = { first, tick_count, offset };
+
+			uint32_t run_count = 0;
+			for(uint32_t t = 0; t < tick_count;) {
+				uint16_t in = r.inputs[(first + t) % TICKS];
+				uint16_t length = 0;
+				while(t < tick_count && r.inputs[(first + t) % TICKS] == in) {
+					length++;
+					t++;
+				}
+				r.runs[run_count++] = { length, { (uint8_t)(in & 0xff), (uint8_t)(in >> 8) } };
+			}
+			uint32_t keyframe_header[3] = { first, tick_count, keyframe_size };
+			ok = file_write(r.file, keyframe_header, sizeof(keyframe_header))
+				&& file_write(r.file, k.snapshot.buffer.data(), keyframe_size)
+				&& file_write(r.file, &run_count, 4)
+				&& file_write(r.file, r.runs, run_count * sizeof(Replay::Run));
+			offset += 16 + keyframe_size + run_count * sizeof(Replay::Run);
+		}
+
+		Replay::Footer footer = { offset, index_count, r.tick, Replay::MAGIC, 0 };
+		ok = ok && file_write(r.file, index, index_count * sizeof(Replay::IndexEntry))
+			&& file_write(r.file, &footer, sizeof(footer));
+		file_close(r.file);
+		r.file = -1;
+		if(!ok) {
+			return false;
+		}
+		file_remove(r.path);
+		return rename(r.temp_path, r.path) == 0;
+	}
+
+	// strlen is not on every list of signal safe calls
+	inline size_t text_length(const char *text) {
+		size_t n = 0;
+		while(text[n] != 0) {
+			n++;
+		}
+		return n;
+	}
+
+	static void on_crash(const char *reason) {
+		if(dump()) {
+			const char *parts[] = { "\n", reason, ": flight recorder wrote ", recording.path, "\n" };
+			for(const char *part : parts) {
+				file_write(2, part, text_length(part));
+			}
+		}
+	}
+
+	// Closes the dump file and removes it, nothing was written to it
+	void stop() {
+		Recording &r = recording;
+		r.enabled = false;
+		if(r.file >= 0) {
+			file_close(r.file);
+			r.file = -1;
+			file_remove(r.temp_path);
+		}
+	}
+
+	// Allocates the snapshots, opens the dump file and installs the crash
+	// handler
+	void start(const char *dump_path) {
+		Recording &r = recording;
+		stop();
+		// path and path.tmp both have to fit, a cut off name would dump elsewhere
+		size_t length = strlen(dump_path);
+		if(length + sizeof(".tmp") > sizeof(r.temp_path) || length + 1 > sizeof(r.path)) {
+			printf("flight recorder path %s is too long, crashes are not recorded\n", dump_path);
+			return;
+		}
+		memcpy(r.path, dump_path, length + 1);
+		memcpy(r.temp_path, dump_path, length);
+		memcpy(r.temp_path + length, ".tmp", sizeof(".tmp"));
+		for(int i = 0; i < SNAPSHOTS; ++i) {
+			world_snapshot_init(r.keyframes[i].snapshot);
+		}
+		r.file = file_open(r.temp_path);
+		if(r.file < 0) {
+			printf("flight recorder could not open %s, crashes are not recorded\n", r.temp_path);
+		}
+		r.tick = 0;
+		r.enabled = true;
+		Engine::set_crash_handler(on_crash);
+	}
+}
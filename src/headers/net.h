@@ -0,0 +1,62 @@
+#ifndef NET_H
+#define NET_H
+
+#include "SDL.h"
+
+// Non-blocking UDP sockets (winsock / BSD sockets).
+// A socket can simulate a bad connection, outgoing packets are then held back
+// by latency + jitter and dropped at random, which is enough to test netplay
+// over localhost.
+namespace Net {
+	const int MAX_PACKET_SIZE = 512;
+	const int MAX_DELAYED_PACKETS = 256;
+
+	struct Address {
+		uint32_t host = 0; // host byte order
+		uint16_t port = 0;
+	};
+
+	inline bool operator==(const Address &a, const Address &b) {
+		return a.host == b.host && a.port == b.port;
+	}
+
+	struct DelayedPacket {
+		Uint32 send_at;
+		Address to;
+		int size;
+		uint8_t data[MAX_PACKET_SIZE];
+	};
+
+	struct Conditions {
+		int latency_ms = 0;
+		int jitter_ms = 0;
+		float loss = 0.0f; // 0 - 1
+	};
+
+	struct Socket {
+		intptr_t handle = -1;
+		Conditions conditions;
+		uint32_t random_state = 0x9e3779b9;
+		// fixed pool so sending never allocates
+		DelayedPacket delayed[MAX_DELAYED_PACKETS];
+		int delayed_n = 0;
+		unsigned sent = 0;
+		unsigned dropped = 0;
+	};
+
+	bool init();
+	void shutdown();
+	// host is a name or dotted address, "localhost" works everywhere
+	bool resolve(const char *host, uint16_t port, Address &address);
+
+	bool socket_open(Socket &socket, uint16_t port);
+	void socket_close(Socket &socket);
+	void socket_set_conditions(Socket &socket, const Conditions &conditions);
+	bool socket_send(Socket &socket, const Address &to, const void *data, int size);
+	// sends delayed packets that are due, call once per tick
+	void socket_update(Socket &socket);
+	// returns the packet size, 0 when nothing is waiting
+	int socket_receive(Socket &socket, Address &from, void *data, int size);
+}
+
+#endif
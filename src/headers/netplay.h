@@ -0,0 +1,256 @@
+// Two player rollback netplay, game code like asteroids.h and included after it.
+//
+// Every tick the local input is sent to the peer and the world is saved. The
+// remote input is predicted (the last one received is repeated) so the game
+// never waits for the network. When the real remote input for a frame arrives
+// and differs from the prediction, the world is restored to that frame and the
+// frames since are simulated again with the corrected input. A peer that gets
+// more than MAX_ROLLBACK frames ahead of the inputs it has stalls instead.
+// Both sides also exchange the state hash of their latest confirmed frame to
+// detect a desync.
+#include "net.h"
+
+namespace Netplay {
+	const int MAX_ROLLBACK = 8;
+	const int INPUT_DELAY = 2;
+	// ring of inputs and hashes, must hold every unacknowledged input
+	const int FRAME_WINDOW = 64;
+	const int SNAPSHOT_WINDOW = MAX_ROLLBACK + 2;
+
+	enum PacketType {
+		PacketHello = 1,
+		PacketInput = 2
+	};
+
+	struct Session {
+		Net::Socket socket;
+		Net::Address remote;
+		int local_player = 0;
+		uint32_t seed = 0;
+		bool started = false;
+		bool peer_started = false;
+
+		int frame = 0;           // next frame to simulate
+		int local_frame = -1;    // last frame with local input
+		int remote_frame = -1;   // last frame with confirmed remote input
+		int peer_ack = -1;       // last local input the peer has confirmed
+		int rollback_from = -1;  // earliest mispredicted frame
+		uint8_t local_inputs[FRAME_WINDOW];
+		uint8_t remote_inputs[FRAME_WINDOW];
+		uint8_t predicted[FRAME_WINDOW];
+		uint64_t hashes[FRAME_WINDOW];
+		WorldSnapshot snapshots[SNAPSHOT_WINDOW];
+
+		unsigned rollbacks = 0;
+		unsigned resimulated = 0;
+		unsigned stalls = 0;
+		float rollback_ms_max = 0.0f;
+		int desync_frame = -1;
+	};
+
+	inline int slot(int frame) {
+		return frame % FRAME_WINDOW;
+	}
+
+	// Player 0 picks the seed, player 1 takes it from the hello packet
+	bool start(Session &s, uint16_t local_port, const char *remote_host, uint16_t remote_port, int local_player, uint32_t seed) {
+		if(!Net::socket_open(s.socket, local_port) || !Net::resolve(remote_host, remote_port, s.remote)) {
+			return false;
+		}
+		s.local_player = local_player;
+		s.seed = seed;
+		s.started = false;
+		for(int i = 0; i < SNAPSHOT_WINDOW; ++i) {
+			world_snapshot_init(s.snapshots[i]);
+		}
+		return true;
+	}
+
+	void stop(Session &s) {
+		Net::socket_close(s.socket);
+		s.started = false;
+	}
+
+	static void begin_game(Session &s) {
+		s.started = true;
+		s.peer_started = false;
+		s.frame = 0;
+		s.peer_ack = -1;
+		s.rollback_from = -1;
+		// the first INPUT_DELAY frames have no input from either side
+		memset(s.local_inputs, 0, sizeof(s.local_inputs));
+		memset(s.remote_inputs, 0, sizeof(s.remote_inputs));
+		s.local_frame = INPUT_DELAY - 1;
+		s.remote_frame = INPUT_DELAY - 1;
+		asteroids_new_game(s.seed);
+	}
+
+	static void send_hello(Session &s) {
+		uint8_t packet[6];
+		packet[0] = PacketHello;
+		packet[1] = (uint8_t)s.local_player;
+		memcpy(packet + 2, &s.seed, sizeof(s.seed));
+		Net::socket_send(s.socket, s.remote, packet, sizeof(packet));
+	}
+
+	// Input packet: type | ack frame | hash frame | hash | first frame | count | inputs
+	// Every input the peer has not acknowledged is sent again, so a lost packet
+	// is covered by the next one.
+	static const int INPUT_HEADER_SIZE = 1 + 4 + 4 + 8 + 4 + 1;
+
+	static void send_inputs(Session &s) {
+		uint8_t packet[INPUT_HEADER_SIZE + FRAME_WINDOW];
+		int32_t ack = s.remote_frame;
+		int32_t hash_frame = std::min(s.remote_frame, s.frame - 1);
+		uint64_t hash = hash_frame >= 0 ? s.hashes[slot(hash_frame)] : 0;
+		int32_t first = s.peer_ack + 1;
+		int count = std::max(0, std::min(s.local_frame - first + 1, FRAME_WINDOW));
+
+		uint8_t *out = packet;
+		*out++ = PacketInput;
+		memcpy(out, &ack, 4); out += 4;
+		memcpy(out, &hash_frame, 4); out += 4;
+		memcpy(out, &hash, 8); out += 8;
+		memcpy(out, &first, 4); out += 4;
+		*out++ = (uint8_t)count;
+		for(int i = 0; i < count; ++i) {
+			*out++ = s.local_inputs[slot(first + i)];
+		}
+		Net::socket_send(s.socket, s.remote, packet, (int)(out - packet));
+	}
+
+	static void check_hash(Session &s, int32_t hash_frame, uint64_t hash) {
+		bool confirmed_here = hash_frame >= 0 && hash_frame <= s.remote_frame && hash_frame < s.frame
+			&& s.frame - hash_frame < FRAME_WINDOW
+			&& (s.rollback_from < 0 || hash_frame < s.rollback_from);
+		if(confirmed_here && s.desync_frame < 0 && s.hashes[slot(hash_frame)] != hash) {
+			s.desync_frame = hash_frame;
+			printf("netplay desync at frame %d: %016llx != %016llx\n", hash_frame,
+				(unsigned long long)s.hashes[slot(hash_frame)], (unsigned long long)hash);
+		}
+	}
+
+	static void read_inputs(Session &s, const uint8_t *in, int size) {
+		if(size < INPUT_HEADER_SIZE) {
+			return;
+		}
+		int32_t ack, hash_frame, first;
+		uint64_t hash;
+		in++;
+		memcpy(&ack, in, 4); in += 4;
+		memcpy(&hash_frame, in, 4); in += 4;
+		memcpy(&hash, in, 8); in += 8;
+		memcpy(&first, in, 4); in += 4;
+		int count = *in++;
+		if(size < INPUT_HEADER_SIZE + count) {
+			return;
+		}
+
+		s.peer_ack = std::max(s.peer_ack, std::min(ack, s.local_frame));
+		for(int i = 0; i < count; ++i) {
+			int f = first + i;
+			if(f != s.remote_frame + 1) {
+				// already have it, or a gap from reordering that a later packet fills
+				continue;
+			}
+			uint8_t bits = in[i];
+			s.remote_inputs[slot(f)] = bits;
+			s.remote_frame = f;
+			if(f < s.frame && s.predicted[slot(f)] != bits && (s.rollback_from < 0 || f < s.rollback_from)) {
+				s.rollback_from = f;
+			}
+		}
+		check_hash(s, hash_frame, hash);
+	}
+
+	static void receive(Session &s) {
+		uint8_t packet[Net::MAX_PACKET_SIZE];
+		Net::Address from;
+		int size;
+		while((size = Net::socket_receive(s.socket, from, packet, sizeof(packet))) > 0) {
+			if(!(from == s.remote)) {
+				continue;
+			}
+			if(packet[0] == PacketHello && size >= 6) {
+				if(!s.started) {
+					if(s.local_player == 1) {
+						memcpy(&s.seed, packet + 2, sizeof(s.seed));
+					}
+					begin_game(s);
+				}
+				// answer until the peer sends inputs, it may have lost our hello
+				if(!s.peer_started) {
+					send_hello(s);
+				}
+			} else if(packet[0] == PacketInput && s.started) {
+				s.peer_started = true;
+				read_inputs(s, packet, size);
+			}
+		}
+	}
+
+	static void simulate_frame(Session &s) {
+		int f = s.frame;
+		world_save(s.snapshots[f % SNAPSHOT_WINDOW]);
+		uint8_t remote = f <= s.remote_frame ? s.remote_inputs[slot(f)] : s.remote_inputs[slot(s.remote_frame)];
+		s.predicted[slot(f)] = remote;
+		uint8_t inputs[2];
+		inputs[s.local_player] = s.local_inputs[slot(f)];
+		inputs[1 - s.local_player] = remote;
+		asteroids_tick(inputs);
+		s.hashes[slot(f)] = asteroids_state_hash();
+		s.frame++;
+	}
+
+	static void rollback(Session &s) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		int from = s.rollback_from;
+		int to = s.frame;
+		s.rollback_from = -1;
+		ASSERT_WITH_MSG(to - from <= MAX_ROLLBACK, "Rollback further than the saved frames!");
+		world_restore(s.snapshots[from % SNAPSHOT_WINDOW]);
+		s.frame = from;
+		while(s.frame < to) {
+			simulate_frame(s);
+		}
+		float ms = (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+		s.rollback_ms_max = std::max(s.rollback_ms_max, ms);
+		s.rollbacks++;
+		s.resimulated += to - from;
+	}
+
+	// Call once per fixed tick instead of asteroids_update, returns false when
+	// no frame was simulated (waiting for the peer or stalled)
+	bool update(Session &s, uint8_t local_input) {
+		Net::socket_update(s.socket);
+		receive(s);
+		if(!s.started) {
+			send_hello(s);
+			return false;
+		}
+
+		if(s.rollback_from >= 0) {
+			rollback(s);
+		}
+
+		bool advanced = false;
+		if(s.frame - s.remote_frame > MAX_ROLLBACK) {
+			s.stalls++;
+		} else {
+			s.local_frame = s.frame + INPUT_DELAY;
+			s.local_inputs[slot(s.local_frame)] = local_input;
+			simulate_frame(s);
+			advanced = true;
+		}
+		send_inputs(s);
+		return advanced;
+	}
+
+	void print_stats(const Session &s) {
+		printf("netplay: %d frames, %u rollbacks (%u frames resimulated, max %.3f ms), %u stalls, %u/%u packets dropped\n",
+			s.frame, s.rollbacks, s.resimulated, s.rollback_ms_max, s.stalls, s.socket.dropped, s.socket.sent + s.socket.dropped);
+		if(s.desync_frame >= 0) {
+			printf("netplay: DESYNC at frame %d\n", s.desync_frame);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include "SDL.h"
+#include <string>
+
+// Packed asset archive, written offline by tools/packer.cpp and memory mapped at load.
+// Layout: Header | Entry[entry_count] | data, every data block 16 byte aligned.
+// Images are stored as raw pixels already in the texture format so loading
+// is a single SDL_UpdateTexture straight from the mapping.
+namespace Pack {
+	const uint32_t MAGIC = 0x4b504153; // "SAPK"
+	const uint32_t VERSION = 1;
+	const uint32_t DATA_ALIGNMENT = 16;
+
+	enum EntryType {
+		Image = 0,
+		Blob = 1
+	};
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entry_count;
+		uint32_t reserved;
+	};
+
+	struct Entry {
+		uint32_t name; // Resources::name_hash of the source file name
+		uint32_t type;
+		uint64_t offset; // from start of file
+		uint64_t size;
+		// Image only
+		uint32_t format; // SDL_PixelFormatEnum
+		int32_t w;
+		int32_t h;
+		int32_t pitch;
+	};
+
+	struct Archive {
+		const uint8_t *base = NULL;
+		size_t size = 0;
+		const Entry *entries = NULL;
+		uint32_t entry_count = 0;
+	};
+
+	bool open(Archive &archive, const std::string &path);
+	void close(Archive &archive);
+	const Entry *find(const Archive &archive, uint32_t name);
+
+	inline bool is_open(const Archive &archive) {
+		return archive.base != NULL;
+	}
+	inline const void *data(const Archive &archive, const Entry *entry) {
+		return archive.base + entry->offset;
+	}
+	// Whether an image entry holds h rows of pitch bytes, each at least w pixels
+	inline bool image_fits(const Entry *entry) {
+		int bytes_per_pixel = SDL_BYTESPERPIXEL(entry->format);
+		return entry->w > 0 && entry->h > 0 && bytes_per_pixel > 0
+			&& entry->pitch >= (int64_t)entry->w * bytes_per_pixel
+			&& entry->size >= (uint64_t)entry->pitch * entry->h;
+	}
+}
+
+#endif
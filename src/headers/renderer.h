@@ -2,8 +2,10 @@
 #define _RENDERER_H
 
 #include "engine.h"
+#include "bitmask.h"
 #include "SDL_ttf.h"
 #include <unordered_map>
+#include <type_traits>
 
 // prefered display to show the window
 #ifndef PREFERRED_DISPLAY
@@ -52,6 +54,13 @@ struct Sprite {
     }
 };
 
+// Collision masks of a sprite from its alpha, rotations[i] is the sprite
+// turned clockwise by i * 360 / rotations.size() degrees the way
+// draw_sprite_centered_rotated turns it, centered on the same point.
+struct SpriteMasks {
+    std::vector<Bitmask::Mask> rotations;
+};
+
 struct SpriteFrame {
 	int id;
 	std::string name;
@@ -65,21 +74,48 @@ struct SpriteSheet {
 	std::unordered_map<std::string, int> sprites_by_name;
 };
 
+namespace Resources {
+    // 32-bit FNV-1a hash of a resource name, usable in constant expressions
+    typedef uint32_t NameHash;
+    constexpr NameHash name_hash(const char *name, NameHash hash = 2166136261u) {
+        return *name == 0 ? hash : name_hash(name + 1, (hash ^ (NameHash)(unsigned char)*name) * 16777619u);
+    }
+}
+
+// Forces the name to be hashed at compile time, use for lookups by literal
+// e.g. Resources::sprite_get(RESOURCE_NAME("ship"))
+#define RESOURCE_NAME(name) (std::integral_constant<Resources::NameHash, Resources::name_hash(name)>::value)
+
 struct Font {
     TTF_Font *font;
-    std::string name;
+    Resources::NameHash name;
+    uint16_t file; // shared in-memory font file
 	inline void set_color(const SDL_Color &color) {
 		//font->setDefaultColor(color);
 	}
 };
 
-namespace Resources {
-    Sprite *sprite_load(const std::string &name, const std::string &filename);
-    Sprite *sprite_get(const std::string &name);
+// Handles are indices into the dense resource arrays, returned at load time
+struct SpriteHandle {
+    uint16_t id;
+};
 
-    Font *font_load(const std::string name, const std::string filename, int pointSize);
-    Font *font_get(const std::string &name);
-    void font_remove(const std::string &name);
+struct FontHandle {
+    uint16_t id;
+};
+
+namespace Resources {
+    // mask_rotations > 0 also builds collision masks at that many angles
+    SpriteHandle sprite_load(const char *name, const std::string &filename, int mask_rotations = 0);
+    Sprite *sprite_get(SpriteHandle handle);
+    Sprite *sprite_get(NameHash name);
+    // NULL unless masks were asked for and the sprite has loaded
+    const SpriteMasks *sprite_masks(SpriteHandle handle);
+
+    FontHandle font_load(const char *name, const std::string &filename, int pointSize);
+    Font *font_get(FontHandle handle);
+    Font *font_get(NameHash name);
+    void font_remove(FontHandle handle);
     
 	enum FontStyle {
 		NORMAL = 0x00,
@@ -89,9 +125,26 @@ namespace Resources {
 		STRIKETHROUGH = 0x08
 	};
     // Styles must be set before drawing text with that font to cache correctly
-    void font_set_style(const std::string &name, FontStyle style);
+    void font_set_style(FontHandle handle, FontStyle style);
     // Outlines must be set before drawing text with that font to cache correctly
-    void font_set_outline(const std::string &name, int outline);
+    void font_set_outline(FontHandle handle, int outline);
+
+    // Async loads return right away, decoding and font parsing runs on worker
+    // threads and the handles become valid once load_update has created the
+    // textures on the render thread
+    SpriteHandle sprite_load_async(const char *name, const std::string &filename, int mask_rotations = 0);
+    FontHandle font_load_async(const char *name, const std::string &filename, int pointSize);
+    bool sprite_ready(SpriteHandle handle);
+    bool font_ready(FontHandle handle);
+    // Finishes completed async loads, returns progress of the current batch in 0..1
+    float load_update();
+    bool load_done();
+    // Blocks until every queued load is done
+    void load_wait();
+
+    // Mounts a packed archive (see pack.h) from the data folder, sprite and font loads
+    // check it by file name before going to disk
+    bool pack_mount(const std::string &filename);
 
     void cleanup();
 }
@@ -120,9 +173,9 @@ void set_default_font(Font *font);
 void draw_g_rectangle_RGBA(int x, int y, int w, int h, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 void draw_g_rectangle_filled_RGBA(int x, int y, int w, int h, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 
-void draw_text_font_centered(Font *font, int x, int y, const SDL_Color &color, std::string text);
-void draw_text_centered(int x, int y, const SDL_Color &color, std::string text);
-void draw_text(int x, int y, const SDL_Color &color, const std::string text);
+void draw_text_font_centered(Font *font, int x, int y, const SDL_Color &color, const char *text);
+void draw_text_centered(int x, int y, const SDL_Color &color, const char *text);
+void draw_text(int x, int y, const SDL_Color &color, const char *text);
 
 void draw_sprite_centered_rotated(const Sprite *sprite, const int &x, const int &y, const float &angle);
 
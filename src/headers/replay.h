@@ -0,0 +1,378 @@
+// Replay files, game code like asteroids.h and included after it.
+//
+// A replay is the per tick input bits of both players, cut into chunks of
+// keyframe_interval ticks. Every chunk starts with a full world snapshot so
+// playback can seek with a single keyframe load and re-simulate from there.
+// Layout:
+//   Header
+//   Chunk: first tick | tick count | keyframe size | keyframe | run count | runs
+//   ...
+//   IndexEntry[index count] | Footer
+// Inputs are run length encoded, a run is { u16 length, u8 player 1, u8 player 2 }.
+// Keyframes are raw world_save output, so replays are only valid for the build
+// that wrote them. Numbers are little endian.
+//
+// Recording hands finished chunks to a writer thread, the tick only copies
+// the world into a preallocated buffer every keyframe_interval ticks.
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+
+namespace Replay {
+	const uint32_t MAGIC = 0x594c5052; // "RPLY"
+	const uint32_t VERSION = 1;
+	const int TICK_RATE = 60;
+	const int CHUNK_POOL = 4;
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t seed;
+		uint32_t keyframe_interval;
+	};
+
+	struct IndexEntry {
+		uint32_t first_tick;
+		uint32_t tick_count;
+		uint64_t offset;
+	};
+
+	struct Footer {
+		uint64_t index_offset;
+		uint32_t index_count;
+		uint32_t total_ticks;
+		uint32_t magic;
+		uint32_t reserved;
+	};
+
+	struct Run {
+		uint16_t length;
+		uint8_t inputs[2];
+	};
+
+	struct Chunk {
+		uint32_t first_tick = 0;
+		uint32_t tick_count = 0;
+		WorldSnapshot keyframe;
+		std::vector<uint16_t> inputs; // player 1 | player 2 << 8
+	};
+
+	struct Recorder {
+		FILE *file = NULL;
+		Header header;
+		uint32_t tick = 0;
+		Chunk *current = NULL;
+		std::vector<std::unique_ptr<Chunk>> chunks;
+		// guarded by mutex
+		std::vector<Chunk*> free_chunks;
+		std::vector<Chunk*> queued;
+		bool stopping = false;
+		std::mutex mutex;
+		std::condition_variable signal;
+		std::thread writer;
+		// writer thread only
+		std::vector<IndexEntry> index;
+		std::vector<Run> runs;
+		uint64_t offset = 0;
+		bool write_failed = false;
+		unsigned late_chunks = 0;
+	};
+
+	static Chunk *new_chunk(Recorder &r) {
+		r.chunks.push_back(std::unique_ptr<Chunk>(new Chunk()));
+		Chunk *c = r.chunks.back().get();
+		world_snapshot_init(c->keyframe);
+		c->inputs.resize(r.header.keyframe_interval);
+		return c;
+	}
+
+	static void write_bytes(Recorder &r, const void *data, size_t size) {
+		if(fwrite(data, 1, size, r.file) != size) {
+			r.write_failed = true;
+		}
+		r.offset += size;
+	}
+
+	static void write_chunk(Recorder &r, const Chunk &c) {
+		r.runs.clear();
+		for(uint32_t i = 0; i < c.tick_count; ++i) {
+			uint16_t in = c.inputs[i];
+			if(!r.runs.empty() && r.runs.back().length < UINT16_MAX
+				&& (r.runs.back().inputs[0] | r.runs.back().inputs[1] << 8) == in) {
+				r.runs.back().length++;
+			} else {
+				r.runs.push_back({ 1, { (uint8_t)(in & 0xff), (uint8_t)(in >> 8) } });
+			}
+		}
+
+		r.index.push_back({ c.first_tick, c.tick_count, r.offset });
+		uint32_t keyframe_size = (uint32_t)c.keyframe.size;
+		uint32_t run_count = (uint32_t)r.runs.size();
+		write_bytes(r, &c.first_tick, 4);
+		write_bytes(r, &c.tick_count, 4);
+		write_bytes(r, &keyframe_size, 4);
+		write_bytes(r, c.keyframe.buffer.data(), keyframe_size);
+		write_bytes(r, &run_count, 4);
+		write_bytes(r, r.runs.data(), run_count * sizeof(Run));
+	}
+
+	static void writer_thread(Recorder *r) {
+		std::unique_lock<std::mutex> lock(r->mutex);
+		while(true) {
+			r->signal.wait(lock, [r] { return !r->queued.empty() || r->stopping; });
+			if(r->queued.empty()) {
+				break;
+			}
+			Chunk *c = r->queued.front();
+			r->queued.erase(r->queued.begin());
+			lock.unlock();
+			write_chunk(*r, *c);
+			lock.lock();
+			r->free_chunks.push_back(c);
+		}
+	}
+
+	bool record_start(Recorder &r, const std::string &path, uint32_t seed, int keyframe_seconds = 10) {
+		r.file = fopen(path.c_str(), "wb");
+		if(r.file == NULL) {
+			printf("could not open %s for recording\n", path.c_str());
+			return false;
+		}
+		r.header = { MAGIC, VERSION, seed, (uint32_t)(keyframe_seconds * TICK_RATE) };
+		r.tick = 0;
+		r.offset = 0;
+		r.current = NULL;
+		r.stopping = false;
+		r.write_failed = false;
+		r.late_chunks = 0;
+		r.index.clear();
+		r.queued.reserve(CHUNK_POOL);
+		for(int i = 0; i < CHUNK_POOL; ++i) {
+			r.free_chunks.push_back(new_chunk(r));
+		}
+		write_bytes(r, &r.header, sizeof(r.header));
+		r.writer = std::thread(writer_thread, &r);
+		return true;
+	}
+
+	static void submit(Recorder &r) {
+		{
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.queued.push_back(r.current);
+		}
+		r.signal.notify_one();
+		r.current = NULL;
+	}
+
+	// Call before asteroids_tick with the inputs it gets
+	void record_tick(Recorder &r, const uint8_t *inputs) {
+		if(r.current != NULL && r.current->tick_count == r.header.keyframe_interval) {
+			submit(r);
+		}
+		if(r.current == NULL) {
+			{
+				std::lock_guard<std::mutex> lock(r.mutex);
+				if(!r.free_chunks.empty()) {
+					r.current = r.free_chunks.back();
+					r.free_chunks.pop_back();
+				}
+			}
+			if(r.current == NULL) {
+				// the writer is behind, growing the pool beats blocking the tick
+				r.current = new_chunk(r);
+				r.late_chunks++;
+			}
+			r.current->first_tick = r.tick;
+			r.current->tick_count = 0;
+			world_save(r.current->keyframe);
+		}
+		r.current->inputs[r.current->tick_count++] = (uint16_t)(inputs[0] | inputs[1] << 8);
+		r.tick++;
+	}
+
+	bool record_stop(Recorder &r) {
+		if(r.file == NULL) {
+			return false;
+		}
+		if(r.current != NULL) {
+			submit(r);
+		}
+		{
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.stopping = true;
+		}
+		r.signal.notify_one();
+		r.writer.join();
+
+		Footer footer = { r.offset, (uint32_t)r.index.size(), r.tick, MAGIC, 0 };
+		write_bytes(r, r.index.data(), r.index.size() * sizeof(IndexEntry));
+		write_bytes(r, &footer, sizeof(footer));
+		bool ok = !r.write_failed && fclose(r.file) == 0;
+		r.file = NULL;
+		r.free_chunks.clear();
+		r.chunks.clear();
+		if(r.late_chunks > 0) {
+			printf("replay writer fell behind %u times\n", r.late_chunks);
+		}
+		return ok;
+	}
+
+	struct Player {
+		FILE *file = NULL;
+		Header header;
+		Footer footer;
+		std::vector<IndexEntry> index;
+		WorldSnapshot keyframe;
+		std::vector<uint16_t> inputs;
+		std::vector<Run> runs;
+		int chunk = -1;
+		uint32_t tick = 0; // next tick to simulate
+		// compare the world with every keyframe played into
+		bool verify = false;
+		int mismatch_tick = -1;
+	};
+
+	// 64 bit offsets, soak test replays can get large
+	static bool seek_file(FILE *file, int64_t offset, int origin) {
+#ifdef _WIN32
+		return _fseeki64(file, offset, origin) == 0;
+#else
+		return fseeko(file, (off_t)offset, origin) == 0;
+#endif
+	}
+
+	static bool read_bytes(Player &p, void *data, size_t size) {
+		return fread(data, 1, size, p.file) == size;
+	}
+
+	bool play_open(Player &p, const std::string &path) {
+		p.file = fopen(path.c_str(), "rb");
+		if(p.file == NULL) {
+			printf("could not open replay %s\n", path.c_str());
+			return false;
+		}
+		bool ok = read_bytes(p, &p.header, sizeof(p.header))
+			&& p.header.magic == MAGIC && p.header.version == VERSION
+			&& seek_file(p.file, -(int64_t)sizeof(Footer), SEEK_END)
+			&& read_bytes(p, &p.footer, sizeof(p.footer))
+			&& p.footer.magic == MAGIC;
+		if(ok) {
+			p.index.resize(p.footer.index_count);
+			ok = seek_file(p.file, (int64_t)p.footer.index_offset, SEEK_SET)
+				&& read_bytes(p, p.index.data(), p.index.size() * sizeof(IndexEntry));
+		}
+		if(!ok) {
+			printf("%s is not a replay of this version or is truncated\n", path.c_str());
+			fclose(p.file);
+			p.file = NULL;
+			return false;
+		}
+		world_snapshot_init(p.keyframe);
+		p.inputs.resize(p.header.keyframe_interval);
+		p.chunk = -1;
+		p.tick = 0;
+		p.mismatch_tick = -1;
+		return true;
+	}
+
+	void play_close(Player &p) {
+		if(p.file != NULL) {
+			fclose(p.file);
+			p.file = NULL;
+		}
+	}
+
+	inline uint32_t total_ticks(const Player &p) {
+		return p.footer.total_ticks;
+	}
+
+	// Reads keyframe and inputs of a chunk, restores the world when asked
+	static bool load_chunk(Player &p, int chunk, bool restore) {
+		const IndexEntry &entry = p.index[chunk];
+		uint32_t first_tick, tick_count, keyframe_size, run_count;
+		bool ok = seek_file(p.file, (int64_t)entry.offset, SEEK_SET)
+			&& read_bytes(p, &first_tick, 4)
+			&& read_bytes(p, &tick_count, 4)
+			&& read_bytes(p, &keyframe_size, 4)
+			&& keyframe_size <= p.keyframe.buffer.size()
+			&& tick_count <= p.inputs.size()
+			&& read_bytes(p, p.keyframe.buffer.data(), keyframe_size)
+			&& read_bytes(p, &run_count, 4);
+		if(ok) {
+			p.runs.resize(run_count);
+			ok = read_bytes(p, p.runs.data(), run_count * sizeof(Run));
+		}
+		if(!ok) {
+			printf("replay chunk %d is corrupt\n", chunk);
+			return false;
+		}
+		p.keyframe.size = keyframe_size;
+
+		uint32_t t = 0;
+		for(const Run &run : p.runs) {
+			for(uint16_t i = 0; i < run.length && t < tick_count; ++i) {
+				p.inputs[t++] = (uint16_t)(run.inputs[0] | run.inputs[1] << 8);
+			}
+		}
+
+		if(restore) {
+			world_restore(p.keyframe);
+		} else if(p.verify && p.mismatch_tick < 0) {
+			GameWorld expected;
+			world_restore(p.keyframe, expected);
+			uint64_t current_hash = asteroids_state_hash();
+			std::swap(world, expected);
+			uint64_t expected_hash = asteroids_state_hash();
+			std::swap(world, expected);
+			if(current_hash != expected_hash) {
+				p.mismatch_tick = (int)first_tick;
+			}
+		}
+		p.chunk = chunk;
+		p.tick = first_tick;
+		return true;
+	}
+
+	// Simulates the next tick, false at the end of the replay
+	bool step(Player &p) {
+		if(p.tick >= p.footer.total_ticks) {
+			return false;
+		}
+		if(p.chunk < 0 || p.tick >= p.index[p.chunk].first_tick + p.index[p.chunk].tick_count) {
+			// the world is already at the next keyframe, it is only restored when
+			// starting playback
+			if(!load_chunk(p, p.chunk + 1, p.chunk < 0)) {
+				return false;
+			}
+		}
+		uint16_t in = p.inputs[p.tick - p.index[p.chunk].first_tick];
+		uint8_t inputs[2] = { (uint8_t)(in & 0xff), (uint8_t)(in >> 8) };
+		asteroids_tick(inputs);
+		p.tick++;
+		return true;
+	}
+
+	// Restores the last keyframe before tick and simulates up to it
+	bool seek(Player &p, uint32_t tick) {
+		if(p.index.empty() || tick > p.footer.total_ticks) {
+			return false;
+		}
+		size_t lo = 0, hi = p.index.size();
+		while(hi - lo > 1) {
+			size_t mid = (lo + hi) / 2;
+			if(p.index[mid].first_tick <= tick) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		if(!load_chunk(p, (int)lo, true)) {
+			return false;
+		}
+		while(p.tick < tick && step(p)) {
+		}
+		return p.tick == tick;
+	}
+}
@@ -0,0 +1,196 @@
+#ifndef VEC2_H
+#define VEC2_H
+
+#include "engine.h"
+#include "fixed.h"
+
+// 2D vector over float or Fixed. A plain aggregate so entities holding it stay
+// trivially copyable and `{ x, y }` initialization works.
+template<typename T>
+struct Vec2T {
+	typedef T scalar;
+
+	T x, y;
+
+	Vec2T &operator+=(Vec2T b) { x += b.x; y += b.y; return *this; }
+	Vec2T &operator-=(Vec2T b) { x -= b.x; y -= b.y; return *this; }
+	Vec2T &operator*=(T s) { x *= s; y *= s; return *this; }
+
+	// friends so the scalar converts, e.g. Vec2x * 3 or Vec2x * 0.5f
+	friend Vec2T operator+(Vec2T a, Vec2T b) { return a += b; }
+	friend Vec2T operator-(Vec2T a, Vec2T b) { return a -= b; }
+	friend Vec2T operator-(Vec2T a) { return { -a.x, -a.y }; }
+	friend Vec2T operator*(Vec2T a, T s) { return a *= s; }
+	friend bool operator==(Vec2T a, Vec2T b) { return a.x == b.x && a.y == b.y; }
+	friend bool operator!=(Vec2T a, Vec2T b) { return !(a == b); }
+};
+
+typedef Vec2T<float> Vec2f;
+typedef Vec2T<Fixed> Vec2x;
+
+namespace Math {
+	template<typename T>
+	inline T dot(Vec2T<T> a, Vec2T<T> b) {
+		return a.x * b.x + a.y * b.y;
+	}
+	template<typename T>
+	inline T length_sq(Vec2T<T> v) {
+		return v.x * v.x + v.y * v.y;
+	}
+	inline float length(Vec2f v) {
+		return length_vector_f(v.x, v.y);
+	}
+	// unit vector pointing at angle degrees
+	template<typename T>
+	inline Vec2T<T> direction_deg(T degrees) {
+		return { cos_deg(degrees), sin_deg(degrees) };
+	}
+	template<typename T>
+	inline bool intersect_circles(Vec2T<T> c1, typename Vec2T<T>::scalar c1_radius, Vec2T<T> c2, typename Vec2T<T>::scalar c2_radius) {
+		return intersect_circles(c1.x, c1.y, c1_radius, c2.x, c2.y, c2_radius);
+	}
+	template<typename T>
+	inline T abs(T value) {
+		return value < 0 ? -value : value;
+	}
+	inline float sqrt(float value) {
+		return sqrt_f(value);
+	}
+
+	// Swept circles. Both moved in a straight line over the tick and ended at
+	// c1 and c2, d = c2 - c1 and w = v2 - v1. How far back from the end, as a
+	// fraction of the tick, they were closest.
+	template<typename T>
+	inline T sweep_closest(Vec2T<T> d, Vec2T<T> w) {
+		T dw = dot(d, w);
+		T ww = dot(w, w);
+		if(dw >= ww) {
+			return T(1);
+		}
+		return dw > 0 ? dw / ww : T(0);
+	}
+	// Whether circles that moved by v1 and v2 over the tick to c1 and c2 touched
+	// on the way, so fast ones cannot pass through each other between ticks.
+	// Circles further apart on an axis than the radii plus the motion cannot
+	// touch, that test comes first and keeps the Fixed products in range.
+	template<typename T>
+	inline bool sweep_circles(Vec2T<T> c1, Vec2T<T> v1, T c1_radius, Vec2T<T> c2, Vec2T<T> v2, T c2_radius) {
+		Vec2T<T> d = c2 - c1;
+		Vec2T<T> w = v2 - v1;
+		T r = c1_radius + c2_radius;
+		if(abs(d.x) > r + abs(w.x) || abs(d.y) > r + abs(w.y)) {
+			return false;
+		}
+		return length_sq(d - w * sweep_closest(d, w)) < r * r;
+	}
+	// For circles sweep_circles says touched, the fraction of the tick from
+	// its start at which they first did, 0 when they already overlapped.
+	// Works in units of the radii so the Fixed squares stay small.
+	template<typename T>
+	inline T time_of_impact(Vec2T<T> c1, Vec2T<T> v1, T c1_radius, Vec2T<T> c2, Vec2T<T> v2, T c2_radius) {
+		T unit = T(1) / (c1_radius + c2_radius);
+		Vec2T<T> d = (c2 - c1) * unit;
+		Vec2T<T> w = (v2 - v1) * unit;
+		if(length_sq(d - w) < T(1)) {
+			return T(0);
+		}
+		// largest root s of |d - w s| = 1, how far back from the end they
+		// touch, in the form without cancellation for the sign of dw
+		T dw = dot(d, w);
+		T ww = dot(w, w);
+		T inside = T(1) - length_sq(d);
+		T q = sqrt(dw * dw + ww * inside);
+		T s = dw > 0 ? (dw + q) / ww : inside / (q - dw);
+		return s >= T(1) ? T(0) : T(1) - s;
+	}
+}
+
+// Functions over arrays of vectors. The float versions use SSE2 or NEON when
+// the target has it and give the same bits as the scalar code either way,
+// Fixed goes through the generic versions below.
+// Vectors are read and written at a stride in bytes, so they can be a field of
+// an entity array, e.g. &asteroids[0].position with sizeof(Asteroid).
+namespace Batch {
+	constexpr size_t mask_words(size_t n) {
+		return (n + 63) / 64;
+	}
+
+	// out[i] = a[i] + b[i]
+	void add(Vec2f *out, const Vec2f *a, const Vec2f *b, size_t n, size_t stride = sizeof(Vec2f));
+	// out[i] = a[i] * s
+	void scale(Vec2f *out, const Vec2f *a, float s, size_t n, size_t stride = sizeof(Vec2f));
+	// out[i] = length_sq(a[i]), out is contiguous
+	void length_sq(float *out, const Vec2f *a, size_t n, size_t stride = sizeof(Vec2f));
+	// Bit i of mask is set when the circle at center overlaps circle i, same test
+	// as Math::intersect_circles(center, radius, centers[i], radii[i]).
+	// centers and radii are contiguous, mask has mask_words(n) words.
+	void overlap_mask(uint64_t *mask, Vec2f center, float radius, const Vec2f *centers, const float *radii, size_t n);
+	// Same with swept circles, bit i is Math::sweep_circles(center, velocity,
+	// radius, centers[i], velocities[i], radii[i]). max_speed is at least
+	// |x| + |y| of every velocities[i], circles out of reach are skipped cheaply.
+	void sweep_mask(uint64_t *mask, Vec2f center, Vec2f velocity, float radius, const Vec2f *centers, const Vec2f *velocities, const float *radii, float max_speed, size_t n);
+
+	template<typename T>
+	inline Vec2T<T> &at(Vec2T<T> *base, size_t i, size_t stride) {
+		return *(Vec2T<T>*)((char*)base + i * stride);
+	}
+	template<typename T>
+	inline const Vec2T<T> &at(const Vec2T<T> *base, size_t i, size_t stride) {
+		return *(const Vec2T<T>*)((const char*)base + i * stride);
+	}
+
+	template<typename T>
+	void add(Vec2T<T> *out, const Vec2T<T> *a, const Vec2T<T> *b, size_t n, size_t stride = sizeof(Vec2T<T>)) {
+		for(size_t i = 0; i < n; ++i) {
+			at(out, i, stride) = at(a, i, stride) + at(b, i, stride);
+		}
+	}
+	template<typename T>
+	void scale(Vec2T<T> *out, const Vec2T<T> *a, T s, size_t n, size_t stride = sizeof(Vec2T<T>)) {
+		for(size_t i = 0; i < n; ++i) {
+			at(out, i, stride) = at(a, i, stride) * s;
+		}
+	}
+	template<typename T>
+	void length_sq(T *out, const Vec2T<T> *a, size_t n, size_t stride = sizeof(Vec2T<T>)) {
+		for(size_t i = 0; i < n; ++i) {
+			out[i] = Math::length_sq(at(a, i, stride));
+		}
+	}
+	template<typename T>
+	void overlap_mask(uint64_t *mask, Vec2T<T> center, T radius, const Vec2T<T> *centers, const T *radii, size_t n) {
+		memset(mask, 0, mask_words(n) * sizeof(uint64_t));
+		for(size_t i = 0; i < n; ++i) {
+			if(Math::intersect_circles(center, radius, centers[i], radii[i])) {
+				mask[i / 64] |= 1ULL << (i % 64);
+			}
+		}
+	}
+	template<typename T>
+	void sweep_mask(uint64_t *mask, Vec2T<T> center, Vec2T<T> velocity, T radius, const Vec2T<T> *centers, const Vec2T<T> *velocities, const T *radii, T max_speed, size_t n) {
+		memset(mask, 0, mask_words(n) * sizeof(uint64_t));
+		for(size_t i = 0; i < n; ++i) {
+			if(Math::sweep_circles(center, velocity, radius, centers[i], velocities[i], radii[i])) {
+				mask[i / 64] |= 1ULL << (i % 64);
+			}
+		}
+	}
+
+	// First set bit at or after from, n when there is none
+	inline unsigned next_set(const uint64_t *mask, unsigned from, unsigned n) {
+		while(from < n) {
+			uint64_t word = mask[from / 64] >> (from % 64);
+			if(word != 0) {
+				while((word & 1) == 0) {
+					word >>= 1;
+					from++;
+				}
+				return std::min(from, n);
+			}
+			from = (from / 64 + 1) * 64;
+		}
+		return n;
+	}
+}
+
+#endif
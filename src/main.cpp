@@ -1,10 +1,17 @@
 #include "engine.h"
 #include "renderer.h"
 #include "asteroids.h"
+#include "netplay.h"
+#include "replay.h"
+#include "flight_recorder.h"
 
 #include <iostream>
+#include <cstring>
 
 gameTimer timer;
+static Netplay::Session netplay;
+static Replay::Recorder recorder;
+static Replay::Player replay;
 
 void windowEvent(const SDL_Event * event);
 
@@ -50,14 +57,102 @@ void input() {
 
 
 int main(int argc, char* argv[]) {
+	// --startup-only exits once everything is loaded, to benchmark cold start
+	// (with SDL_VIDEODRIVER=dummy it runs without a display)
+	// --startup-report <file> writes the startup phase timings as json
+	// --net <local port> <remote host> <remote port> <player 0|1> plays against another process,
+	// --latency <ms> --jitter <ms> --loss <percent> simulate a bad connection
+	// --record <file> records the game, --replay <file> plays a recording back
+	// --bots <count> adds ships flown by bot pilots to a local game
+	bool startup_only = false;
+	std::string startup_report;
+	bool net = false;
+	uint16_t net_local_port = 0, net_remote_port = 0;
+	const char *net_remote_host = NULL;
+	int net_player = 0;
+	Net::Conditions net_conditions;
+	const char *record_path = NULL;
+	const char *replay_path = NULL;
+	int bots = 0;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "--startup-only") == 0) {
+			startup_only = true;
+		} else if(strcmp(argv[i], "--startup-report") == 0 && i + 1 < argc) {
+			startup_report = argv[++i];
+		} else if(strcmp(argv[i], "--net") == 0 && i + 4 < argc) {
+			net = true;
+			net_local_port = (uint16_t)atoi(argv[++i]);
+			net_remote_host = argv[++i];
+			net_remote_port = (uint16_t)atoi(argv[++i]);
+			net_player = atoi(argv[++i]) == 1 ? 1 : 0;
+		} else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replay_path = argv[++i];
+		} else if(strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+			net_conditions.latency_ms = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+			net_conditions.jitter_ms = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+			net_conditions.loss = (float)atof(argv[++i]) / 100.0f;
+		} else if(strcmp(argv[i], "--bots") == 0 && i + 1 < argc) {
+			bots = atoi(argv[++i]);
+		}
+	}
+
+	Startup::phase_begin("startup");
+	Startup::phase_begin("renderer_init");
 	if(!renderer_init("ASTEROIDS", 640, 360, 1)) {
 		printf("init renderer failed");
 		return 1;
 	}
+	Startup::phase_end();
 
 	Engine::init();
 	
+	// config is kept by asteroids_new_game, the peer of a net game would not have the bots
+	world.config.bot_count = net ? 0 : bots;
+	Startup::phase_begin("asteroids_load");
 	asteroids_load();
+	Startup::phase_end();
+	Startup::phase_end();
+
+	Startup::print_report();
+	if(!startup_report.empty() && !Startup::write_report(startup_report)) {
+		printf("could not write startup report %s\n", startup_report.c_str());
+	}
+	if(startup_only) {
+		renderer_destroy();
+		return 0;
+	}
+
+	if(net) {
+		std::random_device seed;
+		if(!Net::init() || !Netplay::start(netplay, net_local_port, net_remote_host, net_remote_port, net_player, seed())) {
+			printf("netplay start failed\n");
+			renderer_destroy();
+			return 1;
+		}
+		Net::socket_set_conditions(netplay.socket, net_conditions);
+	} else if(replay_path != NULL) {
+		if(!Replay::play_open(replay, replay_path)) {
+			renderer_destroy();
+			return 1;
+		}
+	} else if(record_path != NULL) {
+		std::random_device seed;
+		uint32_t record_seed = seed();
+		asteroids_new_game(record_seed);
+		if(!Replay::record_start(recorder, record_path, record_seed)) {
+			renderer_destroy();
+			return 1;
+		}
+	}
+	
+	// the last seconds of a local game are written to crash.rpl if it dies
+	if(!net && replay_path == NULL) {
+		FlightRecorder::start("crash.rpl");
+	}
 	
 	// Initiate timer
     timer.now = SDL_GetPerformanceCounter();
@@ -85,13 +180,32 @@ int main(int argc, char* argv[]) {
         while (timer.accumulator >= timer.fixed_dt) {	
 			input();
 			Engine::update();
-			Time::delta_time = Engine::is_paused() ? 0.0f : Time::delta_time_raw;
-			asteroids_update();
+			if(net) {
+				// both sides must simulate the same ticks, so there is no pause
+				Time::delta_time = Time::delta_time_fixed;
+				Netplay::update(netplay, input_bits_from_keyboard(0));
+			} else if(replay_path != NULL) {
+				Time::delta_time = Time::delta_time_fixed;
+				if(!Engine::is_paused()) {
+					Replay::step(replay);
+				}
+			} else if(!Engine::is_paused()) {
+				// a paused tick is skipped rather than simulated with zero time,
+				// so every recorded tick replays exactly
+				Time::delta_time = Time::delta_time_fixed;
+				uint8_t inputs[2] = { input_bits_from_keyboard(0), input_bits_from_keyboard(1) };
+				if(record_path != NULL) {
+					Replay::record_tick(recorder, inputs);
+				}
+				FlightRecorder::record_tick(inputs);
+				asteroids_tick(inputs);
+			}
 			
             timer.accumulator -= timer.fixed_dt;
         }
 		
 		asteroids_render();
+		Engine::frame_reset();
 
 		fps_frames++;
 #define FPS_INTERVAL 1.0 //seconds.
@@ -104,6 +218,16 @@ int main(int argc, char* argv[]) {
 		}
 	}
 	
+	if(record_path != NULL && !Replay::record_stop(recorder)) {
+		printf("could not write replay %s\n", record_path);
+	}
+	Replay::play_close(replay);
+	FlightRecorder::stop();
+	if(net) {
+		Netplay::print_stats(netplay);
+		Netplay::stop(netplay);
+		Net::shutdown();
+	}
 	renderer_destroy();
 
     return 0;
@@ -0,0 +1,146 @@
+#include "bitmask.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace Bitmask {
+	Mask make(int w, int h) {
+		Mask mask;
+		mask.w = w;
+		mask.h = h;
+		mask.words = (w + 63) / 64;
+		mask.bits.assign((size_t)mask.words * h, 0);
+		return mask;
+	}
+
+	void set(Mask &mask, int x, int y) {
+		mask.bits[y * mask.words + x / 64] |= 1ULL << (x % 64);
+	}
+
+	// In half pixels so it is all integer, the one sqrt is of an integer and
+	// correctly rounded everywhere
+	static void measure(Mask &mask) {
+		int radius_sq = 0;
+		for(int y = 0; y < mask.h; ++y) {
+			for(int x = 0; x < mask.w; ++x) {
+				if(mask.get(x, y)) {
+					int dx = std::max(std::abs(2 * x - mask.w), std::abs(2 * x + 2 - mask.w));
+					int dy = std::max(std::abs(2 * y - mask.h), std::abs(2 * y + 2 - mask.h));
+					radius_sq = std::max(radius_sq, dx * dx + dy * dy);
+				}
+			}
+		}
+		mask.radius = std::sqrt((float)radius_sq) * 0.5f;
+	}
+
+	Mask from_alpha(const uint8_t *alpha, int w, int h, uint8_t threshold) {
+		Mask mask = make(w, h);
+		for(int y = 0; y < h; ++y) {
+			for(int x = 0; x < w; ++x) {
+				if(alpha[y * w + x] >= threshold) {
+					set(mask, x, y);
+				}
+			}
+		}
+		measure(mask);
+		return mask;
+	}
+
+	Mask circle(Fixed radius) {
+		int side = 2 * ((radius.raw + Fixed::ONE - 1) >> Fixed::FRACTION_BITS);
+		int64_t limit = 4 * (int64_t)radius.raw * radius.raw;
+		Mask mask = make(side, side);
+		for(int y = 0; y < side; ++y) {
+			for(int x = 0; x < side; ++x) {
+				// pixel center from the middle, in half pixels
+				int64_t dx = 2 * x + 1 - side;
+				int64_t dy = 2 * y + 1 - side;
+				if((dx * dx + dy * dy) * Fixed::ONE * Fixed::ONE < limit) {
+					set(mask, x, y);
+				}
+			}
+		}
+		measure(mask);
+		return mask;
+	}
+
+	Mask rotated(const Mask &mask, Fixed degrees) {
+		int64_t cos_angle = Math::cos_deg(degrees).raw;
+		int64_t sin_angle = Math::sin_deg(degrees).raw;
+		int diagonal_sq = mask.w * mask.w + mask.h * mask.h;
+		int side = 0;
+		while(side * side < diagonal_sq) {
+			side++;
+		}
+		side = (side + 1) & ~1;
+		Mask out = make(side, side);
+		for(int y = 0; y < side; ++y) {
+			for(int x = 0; x < side; ++x) {
+				// back from the turned pixel center to the source, in half
+				// pixels times Fixed::ONE so the floor is a shift
+				int64_t px = 2 * x + 1 - side;
+				int64_t py = 2 * y + 1 - side;
+				int sx = (int)((cos_angle * px + sin_angle * py + (int64_t)mask.w * Fixed::ONE) >> (Fixed::FRACTION_BITS + 1));
+				int sy = (int)((-sin_angle * px + cos_angle * py + (int64_t)mask.h * Fixed::ONE) >> (Fixed::FRACTION_BITS + 1));
+				if(sx >= 0 && sy >= 0 && sx < mask.w && sy < mask.h && mask.get(sx, sy)) {
+					set(out, x, y);
+				}
+			}
+		}
+		measure(out);
+		return out;
+	}
+
+	// 64 pixels of a row from pixel start on, pixels outside the row are empty
+	static inline uint64_t bits_at(const uint64_t *row, int words, int start) {
+		if(start <= -64 || start >= words * 64) {
+			return 0;
+		}
+		if(start < 0) {
+			return row[0] << -start;
+		}
+		int word = start / 64;
+		int shift = start % 64;
+		uint64_t bits = row[word] >> shift;
+		if(shift != 0 && word + 1 < words) {
+			bits |= row[word + 1] << (64 - shift);
+		}
+		return bits;
+	}
+
+	bool overlap(const Mask &a, int ax, int ay, const Mask &b, int bx, int by) {
+		// b relative to a, and the part of a they share
+		int dx = bx - ax;
+		int dy = by - ay;
+		int x0 = std::max(0, dx);
+		int x1 = std::min(a.w, dx + b.w);
+		int y0 = std::max(0, dy);
+		int y1 = std::min(a.h, dy + b.h);
+		if(x0 >= x1 || y0 >= y1) {
+			return false;
+		}
+		for(int y = y0; y < y1; ++y) {
+			const uint64_t *row_a = &a.bits[y * a.words];
+			const uint64_t *row_b = &b.bits[(y - dy) * b.words];
+			for(int word = x0 / 64; word <= (x1 - 1) / 64; ++word) {
+				if(row_a[word] & bits_at(row_b, b.words, word * 64 - dx)) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	bool overlap_pixels(const Mask &a, int ax, int ay, const Mask &b, int bx, int by) {
+		for(int y = 0; y < a.h; ++y) {
+			for(int x = 0; x < a.w; ++x) {
+				int x_b = ax + x - bx;
+				int y_b = ay + y - by;
+				if(x_b >= 0 && y_b >= 0 && x_b < b.w && y_b < b.h && a.get(x, y) && b.get(x_b, y_b)) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+}
@@ -1,6 +1,13 @@
 #include "engine.h"
-#include <unordered_set>
 #include <fstream>
+#include <cstdarg>
+#include <cstring>
+#include <csignal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define ENGINE_SSE2
+	#include <emmintrin.h>
+#endif
 
 namespace Engine {
 	int32_t current_fps = 0;
@@ -32,6 +39,216 @@ namespace Engine {
 			pause_timer -= Time::delta_time_fixed;
 		}
 	}
+
+	static CrashHandler crash_handler = NULL;
+	static volatile sig_atomic_t crashing = 0;
+
+	static void run_crash_handler(const char *reason) {
+		// an abort after a failed assert raises SIGABRT, run only once
+		if(crashing) {
+			return;
+		}
+		crashing = 1;
+		if(crash_handler != NULL) {
+			crash_handler(reason);
+		}
+	}
+
+	static void crash_signal(int sig) {
+		const char *reason = "signal";
+		switch(sig) {
+			case SIGSEGV: reason = "SIGSEGV"; break;
+			case SIGILL: reason = "SIGILL"; break;
+			case SIGFPE: reason = "SIGFPE"; break;
+			case SIGABRT: reason = "SIGABRT"; break;
+		}
+		run_crash_handler(reason);
+		// die the way we would have without the handler
+		signal(sig, SIG_DFL);
+		raise(sig);
+	}
+
+	void set_crash_handler(CrashHandler handler) {
+		crash_handler = handler;
+		signal(SIGSEGV, crash_signal);
+		signal(SIGILL, crash_signal);
+		signal(SIGFPE, crash_signal);
+		signal(SIGABRT, crash_signal);
+	}
+
+	void crash(const char *reason) {
+		run_crash_handler(reason);
+		std::abort();
+	}
+
+	// Sized so a normal frame never leaves the buffer, anything beyond it
+	// goes to the heap and is given back on reset
+	static const size_t FRAME_MEMORY_SIZE = 64 * 1024;
+	alignas(std::max_align_t) static std::byte frame_buffer[FRAME_MEMORY_SIZE];
+	static std::pmr::monotonic_buffer_resource frame_arena(frame_buffer, FRAME_MEMORY_SIZE);
+
+	std::pmr::memory_resource *frame_memory() {
+		return &frame_arena;
+	}
+
+	void frame_reset() {
+		// rebuilt in place so the next frame starts at the beginning of the
+		// buffer again, release() is not guaranteed to do that
+		frame_arena.~monotonic_buffer_resource();
+		new (&frame_arena) std::pmr::monotonic_buffer_resource(frame_buffer, FRAME_MEMORY_SIZE);
+	}
+
+	const char *frame_printf(const char* fmt, ...) {
+		va_list args;
+		va_start(args, fmt);
+		va_list args_copy;
+		va_copy(args_copy, args);
+		int length = vsnprintf(NULL, 0, fmt, args_copy);
+		va_end(args_copy);
+		if(length < 0) {
+			va_end(args);
+			return "";
+		}
+		char *text = (char*)frame_arena.allocate(length + 1, 1);
+		vsnprintf(text, length + 1, fmt, args);
+		va_end(args);
+		return text;
+	}
+}
+
+namespace Startup {
+	struct Phase {
+		const char *name;
+		int depth;
+		Uint64 start;
+		Uint64 end;
+	};
+
+	static const unsigned MAX_PHASES = 64;
+	static Phase phases[MAX_PHASES];
+	static unsigned phase_n = 0;
+	static unsigned open_phases[MAX_PHASES];
+	static int depth = 0;
+
+	static double to_ms(Uint64 ticks) {
+		return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+	}
+
+	void phase_begin(const char *name) {
+		ASSERT_WITH_MSG(phase_n < MAX_PHASES, "Too many startup phases!");
+		phases[phase_n] = { name, depth, SDL_GetPerformanceCounter(), 0 };
+		open_phases[depth++] = phase_n++;
+	}
+
+	void phase_end() {
+		ASSERT_WITH_MSG(depth > 0, "Startup phase ended without begin");
+		phases[open_phases[--depth]].end = SDL_GetPerformanceCounter();
+	}
+
+	double total_ms() {
+		if(phase_n == 0) {
+			return 0.0;
+		}
+		Uint64 end = phases[0].start;
+		for(unsigned i = 0; i < phase_n; ++i) {
+			end = std::max(end, phases[i].end);
+		}
+		return to_ms(end - phases[0].start);
+	}
+
+	void print_report() {
+		for(unsigned i = 0; i < phase_n; ++i) {
+			printf("%*s%-24s %8.3f ms\n", phases[i].depth * 2, "", phases[i].name, to_ms(phases[i].end - phases[i].start));
+		}
+		printf("startup total %.3f ms\n", total_ms());
+	}
+
+	bool write_report(const std::string &path) {
+		std::ofstream file(path);
+		if(!file) {
+			return false;
+		}
+		file << "{\n\t\"total_ms\": " << total_ms() << ",\n\t\"phases\": [\n";
+		for(unsigned i = 0; i < phase_n; ++i) {
+			const Phase &p = phases[i];
+			file << "\t\t{ \"name\": \"" << p.name << "\", \"depth\": " << p.depth
+				<< ", \"start_ms\": " << to_ms(p.start - phases[0].start)
+				<< ", \"ms\": " << to_ms(p.end - p.start) << " }"
+				<< (i + 1 < phase_n ? ",\n" : "\n");
+		}
+		file << "\t]\n}\n";
+		return (bool)file;
+	}
+}
+
+namespace RNG {
+	static const int LANES = 4;
+
+	// One step of every lane, state is stored word major: s[word][lane]
+	static void step_lanes(uint32_t s[4][LANES], uint32_t result[LANES]) {
+		for(int l = 0; l < LANES; ++l) {
+			result[l] = s[0][l] + s[3][l];
+			uint32_t t = s[1][l] << 9;
+			s[2][l] ^= s[0][l];
+			s[3][l] ^= s[1][l];
+			s[1][l] ^= s[2][l];
+			s[0][l] ^= s[3][l];
+			s[2][l] ^= t;
+			s[3][l] = RandomGenerator::rotl(s[3][l], 11);
+		}
+	}
+
+	void fill_range_f(RandomGenerator &rng, float *out, size_t n, float min, float max) {
+		alignas(16) uint32_t s[4][LANES];
+		uint64_t x = ((uint64_t)rng.next() << 32) | rng.next();
+		x ^= (((uint64_t)rng.next() << 32) | rng.next()) * 0xd1342543de82ef95ULL;
+		for(int w = 0; w < 4; ++w) {
+			uint64_t a = RandomGenerator::splitmix64(x);
+			uint64_t b = RandomGenerator::splitmix64(x);
+			s[w][0] = (uint32_t)a;
+			s[w][1] = (uint32_t)(a >> 32);
+			s[w][2] = (uint32_t)b;
+			s[w][3] = (uint32_t)(b >> 32);
+		}
+
+		const float range = max - min;
+		const float scale = 1.0f / 16777216.0f;
+		size_t i = 0;
+#ifdef ENGINE_SSE2
+		__m128i s0 = _mm_load_si128((const __m128i*)s[0]);
+		__m128i s1 = _mm_load_si128((const __m128i*)s[1]);
+		__m128i s2 = _mm_load_si128((const __m128i*)s[2]);
+		__m128i s3 = _mm_load_si128((const __m128i*)s[3]);
+		const __m128 v_min = _mm_set1_ps(min);
+		const __m128 v_range = _mm_set1_ps(range);
+		const __m128 v_scale = _mm_set1_ps(scale);
+		for(; i + LANES <= n; i += LANES) {
+			__m128i result = _mm_add_epi32(s0, s3);
+			__m128i t = _mm_slli_epi32(s1, 9);
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+			// the top 24 bits fit a signed convert exactly
+			__m128 unit = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), v_scale);
+			_mm_storeu_ps(out + i, _mm_add_ps(v_min, _mm_mul_ps(v_range, unit)));
+		}
+		_mm_store_si128((__m128i*)s[0], s0);
+		_mm_store_si128((__m128i*)s[1], s1);
+		_mm_store_si128((__m128i*)s[2], s2);
+		_mm_store_si128((__m128i*)s[3], s3);
+#endif
+		uint32_t result[LANES];
+		for(; i < n; i += LANES) {
+			step_lanes(s, result);
+			for(int l = 0; l < LANES && i + l < n; ++l) {
+				float unit = (result[l] >> 8) * scale;
+				out[i + l] = min + range * unit;
+			}
+		}
+	}
 }
 
 namespace Time {
@@ -46,29 +263,30 @@ namespace Input {
 	bool mouse_left_down = false;
     const Uint8* current_keyboard_state;
 
-    std::unordered_set<int> keysDown;
-	std::unordered_set<int> keysDownNow;
-	std::unordered_set<int> keysUpNow;
+	// indexed by scancode so mapping events never allocates
+    static bool keys_down[SDL_NUM_SCANCODES];
+	static bool keys_down_now[SDL_NUM_SCANCODES];
+	static bool keys_up_now[SDL_NUM_SCANCODES];
 
     void init() {
     }
  
     void update_states() {
         current_keyboard_state = SDL_GetKeyboardState(NULL);
-        keysDownNow.clear();
-		keysUpNow.clear();
+        memset(keys_down_now, 0, sizeof(keys_down_now));
+		memset(keys_up_now, 0, sizeof(keys_up_now));
 		SDL_GetMouseState(&mousex, &mousey);
 		mouse_left_down = false;
     }
 
     void map(const SDL_Event *event) {
         if (event->type == SDL_KEYDOWN) {
-		    keysDown.insert(event->key.keysym.sym);
-			keysDownNow.insert(event->key.keysym.sym);
+		    keys_down[event->key.keysym.scancode] = true;
+			keys_down_now[event->key.keysym.scancode] = true;
 		}
         if (event->type == SDL_KEYUP) {
-			keysDown.erase(event->key.keysym.sym);
-		    keysUpNow.insert(event->key.keysym.sym);
+			keys_down[event->key.keysym.scancode] = false;
+		    keys_up_now[event->key.keysym.scancode] = true;
 		}
 		if(event->type == SDL_MOUSEBUTTONDOWN) {
 			if(event->button.button == SDL_BUTTON_LEFT ) {
@@ -82,15 +300,15 @@ namespace Input {
     }
 
 	bool key_down_k(const SDL_Keycode &keyCode) {
-        return keysDown.count(keyCode) > 0;
+        return keys_down[SDL_GetScancodeFromKey(keyCode)];
     }
 
     bool key_released(const SDL_Keycode &keyCode) {
-        return keysUpNow.count(keyCode) > 0;
+        return keys_up_now[SDL_GetScancodeFromKey(keyCode)];
     }
 
     bool key_pressed(const SDL_Keycode &keyCode) {
-        return keysDownNow.count(keyCode) > 0;
+        return keys_down_now[SDL_GetScancodeFromKey(keyCode)];
     }
 }
 
@@ -0,0 +1,187 @@
+#include "net.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#pragma comment(lib, "ws2_32.lib")
+	typedef SOCKET native_socket;
+	#define NATIVE_SOCKET_INVALID INVALID_SOCKET
+#else
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	typedef int native_socket;
+	#define NATIVE_SOCKET_INVALID -1
+#endif
+
+namespace Net {
+	bool init() {
+#ifdef _WIN32
+		WSADATA data;
+		if(WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+			printf("WSAStartup failed\n");
+			return false;
+		}
+#endif
+		return true;
+	}
+
+	void shutdown() {
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+
+	bool resolve(const char *host, uint16_t port, Address &address) {
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo *result = NULL;
+		if(getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+			printf("could not resolve %s\n", host);
+			return false;
+		}
+		const sockaddr_in *in = (const sockaddr_in*)result->ai_addr;
+		address.host = ntohl(in->sin_addr.s_addr);
+		address.port = port;
+		freeaddrinfo(result);
+		return true;
+	}
+
+	static sockaddr_in to_sockaddr(const Address &address) {
+		sockaddr_in in;
+		memset(&in, 0, sizeof(in));
+		in.sin_family = AF_INET;
+		in.sin_addr.s_addr = htonl(address.host);
+		in.sin_port = htons(address.port);
+		return in;
+	}
+
+	bool socket_open(Socket &socket, uint16_t port) {
+		native_socket handle = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(handle == NATIVE_SOCKET_INVALID) {
+			printf("could not create socket\n");
+			return false;
+		}
+
+		sockaddr_in in;
+		memset(&in, 0, sizeof(in));
+		in.sin_family = AF_INET;
+		in.sin_addr.s_addr = htonl(INADDR_ANY);
+		in.sin_port = htons(port);
+		bool ok = bind(handle, (const sockaddr*)&in, sizeof(in)) == 0;
+		if(!ok) {
+			printf("could not bind port %u\n", (unsigned)port);
+		}
+
+#ifdef _WIN32
+		u_long non_blocking = 1;
+		ok = ok && ioctlsocket(handle, FIONBIO, &non_blocking) == 0;
+#else
+		ok = ok && fcntl(handle, F_SETFL, O_NONBLOCK) == 0;
+#endif
+		socket.handle = (intptr_t)handle;
+		socket.delayed_n = 0;
+		socket.sent = 0;
+		socket.dropped = 0;
+		if(!ok) {
+			socket_close(socket);
+		}
+		return ok;
+	}
+
+	void socket_close(Socket &socket) {
+		if(socket.handle == -1) {
+			return;
+		}
+#ifdef _WIN32
+		closesocket((native_socket)socket.handle);
+#else
+		close((native_socket)socket.handle);
+#endif
+		socket.handle = -1;
+	}
+
+	void socket_set_conditions(Socket &socket, const Conditions &conditions) {
+		socket.conditions = conditions;
+	}
+
+	// xorshift, the game RNG must not be touched by the network
+	static uint32_t next_random(Socket &socket) {
+		uint32_t x = socket.random_state;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		socket.random_state = x;
+		return x;
+	}
+
+	static bool send_now(Socket &socket, const Address &to, const void *data, int size) {
+		sockaddr_in in = to_sockaddr(to);
+		int sent = (int)sendto((native_socket)socket.handle, (const char*)data, size, 0, (const sockaddr*)&in, sizeof(in));
+		socket.sent++;
+		return sent == size;
+	}
+
+	bool socket_send(Socket &socket, const Address &to, const void *data, int size) {
+		if(size > MAX_PACKET_SIZE) {
+			printf("packet too large: %d bytes\n", size);
+			return false;
+		}
+		const Conditions &c = socket.conditions;
+		if(c.loss > 0.0f && (next_random(socket) & 0xffff) < (uint32_t)(c.loss * 65536.0f)) {
+			socket.dropped++;
+			return true;
+		}
+		if(c.latency_ms <= 0 && c.jitter_ms <= 0) {
+			return send_now(socket, to, data, size);
+		}
+		if(socket.delayed_n == MAX_DELAYED_PACKETS) {
+			// queue is full, treat it like a congested link
+			socket.dropped++;
+			return true;
+		}
+		DelayedPacket &p = socket.delayed[socket.delayed_n++];
+		int jitter = c.jitter_ms > 0 ? (int)(next_random(socket) % (uint32_t)(c.jitter_ms + 1)) : 0;
+		p.send_at = SDL_GetTicks() + c.latency_ms + jitter;
+		p.to = to;
+		p.size = size;
+		memcpy(p.data, data, size);
+		return true;
+	}
+
+	void socket_update(Socket &socket) {
+		Uint32 now = SDL_GetTicks();
+		for(int i = 0; i < socket.delayed_n;) {
+			DelayedPacket &p = socket.delayed[i];
+			if(SDL_TICKS_PASSED(now, p.send_at)) {
+				send_now(socket, p.to, p.data, p.size);
+				// jitter reorders packets anyway, so order is not kept
+				p = socket.delayed[socket.delayed_n - 1];
+				socket.delayed_n--;
+			} else {
+				++i;
+			}
+		}
+	}
+
+	int socket_receive(Socket &socket, Address &from, void *data, int size) {
+		sockaddr_in in;
+		socklen_t in_size = sizeof(in);
+		int received = (int)recvfrom((native_socket)socket.handle, (char*)data, size, 0, (sockaddr*)&in, &in_size);
+		if(received <= 0) {
+			return 0;
+		}
+		from.host = ntohl(in.sin_addr.s_addr);
+		from.port = ntohs(in.sin_port);
+		return received;
+	}
+}
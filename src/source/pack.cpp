@@ -0,0 +1,108 @@
+#include "pack.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace Pack {
+	static const uint8_t *map_file(const std::string &path, size_t &size) {
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(file == INVALID_HANDLE_VALUE) {
+			return NULL;
+		}
+		LARGE_INTEGER file_size;
+		if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+			CloseHandle(file);
+			return NULL;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if(mapping == NULL) {
+			return NULL;
+		}
+		// the view keeps the mapping alive
+		void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		size = (size_t)file_size.QuadPart;
+		return (const uint8_t*)view;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0) {
+			return NULL;
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return NULL;
+		}
+		void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if(view == MAP_FAILED) {
+			return NULL;
+		}
+		size = (size_t)st.st_size;
+		return (const uint8_t*)view;
+#endif
+	}
+
+	static void unmap_file(const uint8_t *base, size_t size) {
+#ifdef _WIN32
+		UnmapViewOfFile(base);
+#else
+		munmap((void*)base, size);
+#endif
+	}
+
+	bool open(Archive &archive, const std::string &path) {
+		size_t size = 0;
+		const uint8_t *base = map_file(path, size);
+		if(base == NULL) {
+			return false;
+		}
+
+		const Header *header = (const Header*)base;
+		bool valid = size >= sizeof(Header)
+			&& header->magic == MAGIC
+			&& header->version == VERSION
+			&& size >= sizeof(Header) + (uint64_t)header->entry_count * sizeof(Entry);
+		const Entry *entries = (const Entry*)(base + sizeof(Header));
+		for(uint32_t i = 0; valid && i < header->entry_count; ++i) {
+			valid = entries[i].offset <= size && entries[i].size <= size - entries[i].offset;
+		}
+		if(!valid) {
+			printf("Invalid asset pack %s\n", path.c_str());
+			unmap_file(base, size);
+			return false;
+		}
+
+		archive.base = base;
+		archive.size = size;
+		archive.entries = entries;
+		archive.entry_count = header->entry_count;
+		return true;
+	}
+
+	void close(Archive &archive) {
+		if(archive.base != NULL) {
+			unmap_file(archive.base, archive.size);
+		}
+		archive = Archive();
+	}
+
+	const Entry *find(const Archive &archive, uint32_t name) {
+		for(uint32_t i = 0; i < archive.entry_count; ++i) {
+			if(archive.entries[i].name == name) {
+				return &archive.entries[i];
+			}
+		}
+		return NULL;
+	}
+}
@@ -1,6 +1,11 @@
 #include "renderer.h"
 #include "SDL_image.h"
+#include "pack.h"
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 unsigned gw;
 unsigned gh;
@@ -13,121 +18,561 @@ Font *default_font;
 gfx renderer;
 
 namespace Resources {
-	std::unordered_map<std::string, Sprite*> sprites;
-	std::unordered_map<std::string, Font*> fonts;
-	
-	static SDL_Texture* load_texture(const std::string &path, int &w, int &h) { 
-		//The final texture 
-		SDL_Texture* newTexture = NULL; 
-		//Load image at specified path 
-		SDL_Surface* loadedSurface = IMG_Load( path.c_str() ); 
-		if( loadedSurface == NULL ) { 
-			printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() ); 
-		} else { 
-			//Create texture from surface pixels 
-			newTexture = SDL_CreateTextureFromSurface(renderer.renderer, loadedSurface ); 
-			if( newTexture == NULL ) { 
-				printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() ); 
-			} 
-
-			w = loadedSurface->w;
-			h = loadedSurface->h;
-
-			//Get rid of old loaded surface 
-			SDL_FreeSurface( loadedSurface ); 
-		} 
-		return newTexture; 
-	}
-
-    Sprite *sprite_load(const std::string &name, const std::string &filename) {
+	static const unsigned MAX_SPRITES = 64;
+	static const unsigned MAX_FONTS = 32;
+
+	// dense storage indexed by handle, names are kept in a parallel array
+	static Sprite sprites[MAX_SPRITES];
+	static SpriteMasks sprite_mask_sets[MAX_SPRITES];
+	static NameHash sprite_names[MAX_SPRITES];
+	// bumped each time a slot is reserved, a job for an older generation was
+	// replaced while in flight and is dropped when it finishes
+	static uint32_t sprite_generations[MAX_SPRITES];
+	static unsigned sprite_n = 0;
+	static Font fonts[MAX_FONTS];
+	static unsigned font_n = 0;
+
+	// Font files are read into memory once and shared by every point size
+	// opened from them, the data is freed when the last font using it is removed
+	struct FontFile {
+		NameHash name; // hash of the file name
+		const void *data;
+		size_t size;
+		bool owned; // false when the data lives in the mounted pack
+		int ref_count;
+	};
+	static FontFile font_files[MAX_FONTS];
+	static unsigned font_file_n = 0;
+	// a font slot is reserved while its async load is in flight
+	static bool font_pending[MAX_FONTS];
+	// FreeType is not safe for opening faces from several threads, this
+	// guards that and the font file registry
+	static std::mutex font_mutex;
+
+	static Pack::Archive pack;
+
+	bool pack_mount(const std::string &filename) {
+		Pack::close(pack);
 		std::string path = Engine::get_base_data_folder() + filename;
-		Sprite *s = new Sprite;
-    	s->image = load_texture(path, s->w, s->h);
-		sprites[name] = s;
-		return s;
+		return Pack::open(pack, path);
+	}
+
+	// Creates the texture straight from the mapped pixels, no decode or conversion
+	static SDL_Texture* load_texture_packed(const Pack::Entry *entry, int &w, int &h) {
+		SDL_Texture *texture = SDL_CreateTexture(renderer.renderer, entry->format, SDL_TEXTUREACCESS_STATIC, entry->w, entry->h);
+		if(texture == NULL) {
+			printf("Unable to create packed texture! SDL Error: %s\n", SDL_GetError());
+			return NULL;
+		}
+		SDL_UpdateTexture(texture, NULL, Pack::data(pack, entry), entry->pitch);
+		if(SDL_ISPIXELFORMAT_ALPHA(entry->format)) {
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+		}
+		w = entry->w;
+		h = entry->h;
+		return texture;
 	}
 	
-    Sprite *sprite_get(const std::string &name) {
-		return sprites.at(name);
+    Sprite *sprite_get(SpriteHandle handle) {
+		ASSERT_WITH_MSG(handle.id < sprite_n, "Invalid sprite handle");
+		return &sprites[handle.id];
+	}
+
+    Sprite *sprite_get(NameHash name) {
+		for(unsigned i = 0; i < sprite_n; ++i) {
+			if(sprite_names[i] == name) {
+				return &sprites[i];
+			}
+		}
+		ASSERT_WITH_MSG(false, "Sprite not loaded");
+		return NULL;
+	}
+
+	const SpriteMasks *sprite_masks(SpriteHandle handle) {
+		ASSERT_WITH_MSG(handle.id < sprite_n, "Invalid sprite handle");
+		const SpriteMasks &masks = sprite_mask_sets[handle.id];
+		return sprites[handle.id].image != NULL && !masks.rotations.empty() ? &masks : NULL;
 	}
 	
-    Font *font_load(const std::string name, const std::string filename, int pointSize) {
-		std::string path = Engine::get_base_data_folder() + filename;
-		Font *f = new Font;
-		TTF_Font *font = TTF_OpenFont(path.c_str(), pointSize);
-		f->font = font;
-		f->name = name;
-		fonts[name] = f;
-		return f;
+	static uint16_t font_file_acquire(const std::string &filename) {
+		NameHash name = name_hash(filename.c_str());
+		uint16_t free_id = (uint16_t)font_file_n;
+		for(unsigned i = 0; i < font_file_n; ++i) {
+			if(font_files[i].ref_count > 0 && font_files[i].name == name) {
+				font_files[i].ref_count++;
+				return (uint16_t)i;
+			}
+			if(font_files[i].ref_count == 0 && free_id == font_file_n) {
+				free_id = (uint16_t)i;
+			}
+		}
+		if(free_id == font_file_n) {
+			ASSERT_WITH_MSG(font_file_n < MAX_FONTS, "Too many font files!");
+			font_file_n++;
+		}
+
+		FontFile &file = font_files[free_id];
+		file.name = name;
+		file.ref_count = 1;
+		const Pack::Entry *entry = Pack::find(pack, name);
+		if(entry != NULL && entry->type == Pack::Blob) {
+			// the mapping stays alive until cleanup so the fonts can read from it directly
+			file.data = Pack::data(pack, entry);
+			file.size = (size_t)entry->size;
+			file.owned = false;
+		} else {
+			std::string path = Engine::get_base_data_folder() + filename;
+			file.data = SDL_LoadFile(path.c_str(), &file.size);
+			file.owned = true;
+			if(file.data == NULL) {
+				printf("Unable to load font file %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+			}
+		}
+		return free_id;
+	}
+
+	static void font_file_release(uint16_t id) {
+		FontFile &file = font_files[id];
+		ASSERT_WITH_MSG(file.ref_count > 0, "Font file released too many times");
+		if(--file.ref_count == 0) {
+			if(file.owned) {
+				SDL_free((void*)file.data);
+			}
+			file.data = NULL;
+			file.size = 0;
+		}
+	}
+
+	static uint16_t sprite_reserve(const char *name) {
+		NameHash hash = name_hash(name);
+		uint16_t id = (uint16_t)sprite_n;
+		for(unsigned i = 0; i < sprite_n; ++i) {
+			if(sprite_names[i] == hash) {
+				// reloading a name replaces the sprite in the same slot
+				SDL_DestroyTexture(sprites[i].image);
+				sprites[i].image = NULL;
+				sprite_mask_sets[i].rotations.clear();
+				id = (uint16_t)i;
+				break;
+			}
+		}
+		if(id == sprite_n) {
+			ASSERT_WITH_MSG(sprite_n < MAX_SPRITES, "Too many sprites!");
+			sprites[id].image = NULL;
+			sprite_n++;
+		}
+		sprite_names[id] = hash;
+		sprite_generations[id]++;
+		return id;
 	}
 
-    Font *font_get(const std::string &name) {
-		return fonts.at(name);
+	static uint16_t font_reserve(const char *name) {
+		// reuse a slot freed by font_remove if there is one
+		uint16_t id = (uint16_t)font_n;
+		for(unsigned i = 0; i < font_n; ++i) {
+			if(fonts[i].font == NULL && !font_pending[i]) {
+				id = (uint16_t)i;
+				break;
+			}
+		}
+		if(id == font_n) {
+			ASSERT_WITH_MSG(font_n < MAX_FONTS, "Too many fonts!");
+			font_n++;
+		}
+		fonts[id].font = NULL;
+		fonts[id].name = name_hash(name);
+		font_pending[id] = true;
+		return id;
+	}
+
+	// Loads are split in a prepare step that is safe to run on a worker thread
+	// (reading, decoding, parsing fonts) and a finish step on the render thread
+	// that creates the textures. The blocking loads run both in a row.
+	struct LoadJob {
+		enum Type {
+			SpriteJob,
+			FontJob
+		} type;
+		uint16_t id;
+		uint32_t generation;
+		std::string filename;
+		int point_size;
+		int mask_rotations;
+		SpriteMasks masks;
+		const Pack::Entry *entry; // packed image, nothing to prepare
+		SDL_Surface *surface;
+		TTF_Font *font;
+		uint16_t file;
+	};
+
+	// decoded images are converted to the renderer's preferred format on the
+	// worker so texture creation does not convert on the render thread
+	static Uint32 texture_format = SDL_PIXELFORMAT_ARGB8888;
+
+	static LoadJob make_job(LoadJob::Type type, uint16_t id, const std::string &filename, int point_size, int mask_rotations = 0) {
+		LoadJob job;
+		job.type = type;
+		job.id = id;
+		job.generation = type == LoadJob::SpriteJob ? sprite_generations[id] : 0;
+		job.filename = filename;
+		job.point_size = point_size;
+		job.mask_rotations = mask_rotations;
+		job.entry = NULL;
+		job.surface = NULL;
+		job.font = NULL;
+		job.file = 0;
+		if(type == LoadJob::SpriteJob) {
+			const Pack::Entry *entry = Pack::find(pack, name_hash(filename.c_str()));
+			if(entry != NULL && entry->type == Pack::Image) {
+				if(Pack::image_fits(entry)) {
+					job.entry = entry;
+				} else {
+					printf("Packed image %s is too small for its pixels, loading the file\n", filename.c_str());
+				}
+			}
+		}
+		return job;
+	}
+
+	// Masks from the alpha of 32-bit pixels, other formats have no alpha and
+	// are solid
+	static void build_masks(LoadJob &job, const void *pixels, Uint32 format, int w, int h, int pitch) {
+		int bpp;
+		Uint32 r, g, b, a;
+		if(!SDL_PixelFormatEnumToMasks(format, &bpp, &r, &g, &b, &a) || SDL_BYTESPERPIXEL(format) != 4) {
+			a = 0;
+		}
+		int shift = 0;
+		while(a != 0 && ((a >> shift) & 1) == 0) {
+			shift++;
+		}
+		std::vector<uint8_t> alpha((size_t)w * h, 255);
+		for(int y = 0; a != 0 && y < h; ++y) {
+			const Uint32 *row = (const Uint32*)((const uint8_t*)pixels + y * pitch);
+			for(int x = 0; x < w; ++x) {
+				alpha[y * w + x] = (uint8_t)((row[x] & a) >> shift);
+			}
+		}
+		Bitmask::Mask mask = Bitmask::from_alpha(alpha.data(), w, h);
+		for(int i = 0; i < job.mask_rotations; ++i) {
+			job.masks.rotations.push_back(Bitmask::rotated(mask, Fixed(i * 360) / Fixed(job.mask_rotations)));
+		}
+	}
+
+	static void prepare(LoadJob &job) {
+		if(job.type == LoadJob::SpriteJob) {
+			if(job.entry != NULL) {
+				if(job.mask_rotations > 0) {
+					build_masks(job, Pack::data(pack, job.entry), job.entry->format, job.entry->w, job.entry->h, job.entry->pitch);
+				}
+				return;
+			}
+			std::string path = Engine::get_base_data_folder() + job.filename;
+			SDL_Surface *loaded = IMG_Load(path.c_str());
+			if(loaded == NULL) {
+				printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+				return;
+			}
+			job.surface = SDL_ConvertSurfaceFormat(loaded, texture_format, 0);
+			SDL_FreeSurface(loaded);
+			if(job.surface != NULL && job.mask_rotations > 0) {
+				build_masks(job, job.surface->pixels, job.surface->format->format, job.surface->w, job.surface->h, job.surface->pitch);
+			}
+		} else {
+			std::lock_guard<std::mutex> lock(font_mutex);
+			job.file = font_file_acquire(job.filename);
+			const FontFile &file = font_files[job.file];
+			if(file.data != NULL) {
+				SDL_RWops *rw = SDL_RWFromConstMem(file.data, (int)file.size);
+				job.font = TTF_OpenFontRW(rw, 1, job.point_size);
+			}
+			if(job.font == NULL) {
+				printf("Unable to open font %s! TTF Error: %s\n", job.filename.c_str(), TTF_GetError());
+				font_file_release(job.file);
+			}
+		}
+	}
+
+	static void finish(LoadJob &job) {
+		if(job.type == LoadJob::SpriteJob) {
+			if(job.generation != sprite_generations[job.id]) {
+				SDL_FreeSurface(job.surface);
+				job.surface = NULL;
+				return;
+			}
+			Sprite &s = sprites[job.id];
+			sprite_mask_sets[job.id] = job.masks;
+			if(job.entry != NULL) {
+				s.image = load_texture_packed(job.entry, s.w, s.h);
+			} else if(job.surface != NULL) {
+				s.image = SDL_CreateTextureFromSurface(renderer.renderer, job.surface);
+				if(s.image == NULL) {
+					printf("Unable to create texture from %s! SDL Error: %s\n", job.filename.c_str(), SDL_GetError());
+				}
+				s.w = job.surface->w;
+				s.h = job.surface->h;
+				SDL_FreeSurface(job.surface);
+				job.surface = NULL;
+			}
+		} else {
+			fonts[job.id].font = job.font;
+			fonts[job.id].file = job.file;
+			font_pending[job.id] = false;
+		}
+	}
+
+	static std::vector<std::thread> workers;
+	static std::mutex job_mutex;
+	static std::condition_variable job_signal;
+	static std::deque<LoadJob> jobs_queued;
+	static std::deque<LoadJob> jobs_prepared;
+	static bool workers_quit = false;
+	// progress counters, only touched on the render thread
+	static unsigned jobs_total = 0;
+	static unsigned jobs_finished = 0;
+
+	static void worker_run() {
+		std::unique_lock<std::mutex> lock(job_mutex);
+		while(true) {
+			job_signal.wait(lock, [] { return workers_quit || !jobs_queued.empty(); });
+			if(workers_quit) {
+				return;
+			}
+			LoadJob job = jobs_queued.front();
+			jobs_queued.pop_front();
+			lock.unlock();
+			prepare(job);
+			lock.lock();
+			jobs_prepared.push_back(job);
+		}
+	}
+
+	static void queue_job(const LoadJob &job) {
+		if(workers.empty()) {
+			SDL_RendererInfo info;
+			if(SDL_GetRendererInfo(renderer.renderer, &info) == 0 && info.num_texture_formats > 0) {
+				texture_format = info.texture_formats[0];
+			}
+			// the render thread only finishes jobs so leave it one core
+			int worker_count = std::max(1, SDL_GetCPUCount() - 1);
+			workers_quit = false;
+			for(int i = 0; i < worker_count; ++i) {
+				workers.push_back(std::thread(worker_run));
+			}
+		}
+		if(jobs_finished == jobs_total) {
+			jobs_total = jobs_finished = 0;
+		}
+		jobs_total++;
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			jobs_queued.push_back(job);
+		}
+		job_signal.notify_one();
+	}
+
+	static void workers_stop() {
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			workers_quit = true;
+		}
+		job_signal.notify_all();
+		for(auto &worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+    SpriteHandle sprite_load(const char *name, const std::string &filename, int mask_rotations) {
+		uint16_t id = sprite_reserve(name);
+		LoadJob job = make_job(LoadJob::SpriteJob, id, filename, 0, mask_rotations);
+		prepare(job);
+		finish(job);
+		return { id };
+	}
+
+    FontHandle font_load(const char *name, const std::string &filename, int pointSize) {
+		uint16_t id = font_reserve(name);
+		LoadJob job = make_job(LoadJob::FontJob, id, filename, pointSize);
+		prepare(job);
+		finish(job);
+		return { id };
+	}
+
+    SpriteHandle sprite_load_async(const char *name, const std::string &filename, int mask_rotations) {
+		uint16_t id = sprite_reserve(name);
+		queue_job(make_job(LoadJob::SpriteJob, id, filename, 0, mask_rotations));
+		return { id };
+	}
+
+    FontHandle font_load_async(const char *name, const std::string &filename, int pointSize) {
+		uint16_t id = font_reserve(name);
+		queue_job(make_job(LoadJob::FontJob, id, filename, pointSize));
+		return { id };
+	}
+
+	bool sprite_ready(SpriteHandle handle) {
+		return handle.id < sprite_n && sprites[handle.id].image != NULL;
+	}
+
+	bool font_ready(FontHandle handle) {
+		return handle.id < font_n && fonts[handle.id].font != NULL;
+	}
+
+	float load_update() {
+		std::deque<LoadJob> prepared;
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			prepared.swap(jobs_prepared);
+		}
+		for(auto &job : prepared) {
+			finish(job);
+			jobs_finished++;
+		}
+		return jobs_total == 0 ? 1.0f : (float)jobs_finished / jobs_total;
+	}
+
+	bool load_done() {
+		return jobs_finished == jobs_total;
+	}
+
+	void load_wait() {
+		while(!load_done()) {
+			load_update();
+			if(!load_done()) {
+				SDL_Delay(1);
+			}
+		}
+	}
+
+    Font *font_get(FontHandle handle) {
+		ASSERT_WITH_MSG(handle.id < font_n && fonts[handle.id].font != NULL, "Invalid font handle");
+		return &fonts[handle.id];
+	}
+
+    Font *font_get(NameHash name) {
+		for(unsigned i = 0; i < font_n; ++i) {
+			if(fonts[i].font != NULL && fonts[i].name == name) {
+				return &fonts[i];
+			}
+		}
+		ASSERT_WITH_MSG(false, "Font not loaded");
+		return NULL;
 	}
 	
-	void font_set_style(const std::string &name, FontStyle style) {
-		TTF_SetFontStyle(fonts.at(name)->font, style);
+	void font_set_style(FontHandle handle, FontStyle style) {
+		TTF_SetFontStyle(font_get(handle)->font, style);
 	}
 
-	void font_set_outline(const std::string &name, int outline) {
-		TTF_SetFontOutline(fonts.at(name)->font, outline);
+	void font_set_outline(FontHandle handle, int outline) {
+		TTF_SetFontOutline(font_get(handle)->font, outline);
 	}
 
-    void font_remove(const std::string& name) {
-		auto itr = fonts.find(name);
-		if (itr != fonts.end()) {
-			TTF_CloseFont(itr->second->font);
-    		delete itr->second;
-    		fonts.erase(itr);
+    void font_remove(FontHandle handle) {
+		if (handle.id < font_n && fonts[handle.id].font != NULL) {
+			std::lock_guard<std::mutex> lock(font_mutex);
+			TTF_CloseFont(fonts[handle.id].font);
+			fonts[handle.id].font = NULL;
+			font_file_release(fonts[handle.id].file);
+			// the slot can be reused by another font with the same name
+			TextCache::clear();
 		}
 	}
 
     void cleanup() {
-		for(std::unordered_map<std::string, Sprite*>::iterator itr = sprites.begin(); itr != sprites.end(); itr++) {
-			SDL_DestroyTexture(itr->second->image);
-        	delete itr->second;
+		load_wait();
+		workers_stop();
+
+		for(unsigned i = 0; i < sprite_n; ++i) {
+			SDL_DestroyTexture(sprites[i].image);
+			sprites[i].image = NULL;
+			sprite_mask_sets[i].rotations.clear();
     	}
-		sprites.clear();
-		for(std::unordered_map<std::string, Font*>::iterator itr = fonts.begin(); itr != fonts.end(); itr++) {
-			TTF_CloseFont(itr->second->font);
-			delete itr->second;
+		sprite_n = 0;
+		for(unsigned i = 0; i < font_n; ++i) {
+			if(fonts[i].font != NULL) {
+				TTF_CloseFont(fonts[i].font);
+				fonts[i].font = NULL;
+				font_file_release(fonts[i].file);
+			}
     	}
-		fonts.clear();
+		font_n = 0;
+		font_file_n = 0;
 
 		TextCache::clear();
+		Pack::close(pack);
 	}
 }
 
 namespace TextCache {
-	std::unordered_map<size_t, Sprite> text_cache;
-	std::hash<std::string> hasher;
-
-	static size_t cache_key(Font *font, const SDL_Color &color, const char *text) {
-		int colors = color.r | (color.g << 8) | (color.b << 16) | (color.a << 24);
-		return hasher(font->name + text + std::to_string(colors));
+	// Fixed size set associative cache, a miss in a full set evicts the least
+	// recently used text there so the cache never allocates or grows
+	static const unsigned SETS = 128;
+	static const unsigned WAYS = 4;
+
+	struct Entry {
+		uint64_t key;
+		uint32_t last_used;
+		Sprite sprite; // image is NULL for empty entries
+	};
+	static Entry text_cache[SETS][WAYS];
+	static uint32_t use_counter = 0;
+
+	// 64-bit FNV-1a over the text, seeded with the font name and color
+	static uint64_t cache_key(Font *font, const SDL_Color &color, const char *text) {
+		uint32_t colors = color.r | (color.g << 8) | (color.b << 16) | ((uint32_t)color.a << 24);
+		uint64_t key = 14695981039346656037ull ^ (((uint64_t)font->name << 32) | colors);
+		for(; *text; ++text) {
+			key = (key ^ (unsigned char)*text) * 1099511628211ull;
+		}
+		return key;
 	}
 
 	Sprite &load(Font *font, const SDL_Color &color, const char *text) {
-		size_t key = cache_key(font, color, text);
-
-		auto item = text_cache.find(key);
-		if(item == text_cache.end()) {
-			Sprite ci;
-			SDL_Surface *surface = TTF_RenderText_Solid(font->font, text, color);
-			ci.image = SDL_CreateTextureFromSurface(renderer.renderer, surface);
-			SDL_FreeSurface(surface);
-			SDL_QueryTexture(ci.image, NULL, NULL, &ci.w, &ci.h);
-			text_cache[key] = ci;
-		} 
+		uint64_t key = cache_key(font, color, text);
+		Entry *set = text_cache[key % SETS];
+		use_counter++;
+
+		Entry *victim = &set[0];
+		for(unsigned i = 0; i < WAYS; ++i) {
+			Entry &entry = set[i];
+			if(entry.sprite.image == NULL) {
+				if(victim->sprite.image != NULL) {
+					victim = &entry;
+				}
+				continue;
+			}
+			if(entry.key == key) {
+				entry.last_used = use_counter;
+				return entry.sprite;
+			}
+			if(victim->sprite.image != NULL && entry.last_used < victim->last_used) {
+				victim = &entry;
+			}
+		}
 
-		return text_cache[key];
+		if(victim->sprite.image != NULL) {
+			SDL_DestroyTexture(victim->sprite.image);
+		}
+		Sprite &ci = victim->sprite;
+		SDL_Surface *surface = TTF_RenderText_Solid(font->font, text, color);
+		ci.image = SDL_CreateTextureFromSurface(renderer.renderer, surface);
+		SDL_FreeSurface(surface);
+		SDL_QueryTexture(ci.image, NULL, NULL, &ci.w, &ci.h);
+		victim->key = key;
+		victim->last_used = use_counter;
+		return ci;
 	}
 
 	void clear() {
-		for(auto &cache_item : text_cache) {
-			SDL_DestroyTexture(cache_item.second.image);
+		for(auto &set : text_cache) {
+			for(auto &entry : set) {
+				if(entry.sprite.image != NULL) {
+					SDL_DestroyTexture(entry.sprite.image);
+					entry.sprite.image = NULL;
+				}
+			}
 		}
-		text_cache.clear();
 	}
 }
 
@@ -217,17 +662,17 @@ void draw_text_font(Font *font, int x, int y, const SDL_Color &color, const char
 	draw_sprite(&cacheItem, x, y);
 }
 
-void draw_text(int x, int y, const SDL_Color &color, const std::string text) {
-	draw_text_font(default_font, x, y, color, text.c_str());
+void draw_text(int x, int y, const SDL_Color &color, const char *text) {
+	draw_text_font(default_font, x, y, color, text);
 }
 
-void draw_text_font_centered(Font *font, int x, int y, const SDL_Color &color, const std::string text) {
-	Sprite &cacheItem = TextCache::load(font, color, text.c_str());
+void draw_text_font_centered(Font *font, int x, int y, const SDL_Color &color, const char *text) {
+	Sprite &cacheItem = TextCache::load(font, color, text);
 	draw_sprite_centered(&cacheItem, x, y);
 }
 
-void draw_text_centered(int x, int y, const SDL_Color &color, std::string text) {
-	draw_text_font_centered(default_font, x, y, color, text.c_str());
+void draw_text_centered(int x, int y, const SDL_Color &color, const char *text) {
+	draw_text_font_centered(default_font, x, y, color, text);
 }
 
 void draw_g_rectangle_RGBA(int x, int y, int w, int h, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
@@ -253,34 +698,56 @@ int renderer_init(const char *title, unsigned vw, unsigned vh, unsigned scale) {
 	windowPos = SDL_WINDOWPOS_CENTERED;
 
 	// SDL_INIT_AUDIO
+	Startup::phase_begin("SDL_Init");
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		printf("Could not initialize: %s\n", SDL_GetError());
-		return -1;
+		return 0;
 	} 
+	Startup::phase_end();
 	
+	Startup::phase_begin("SDL_CreateWindow");
 	renderer.sdl_window = SDL_CreateWindow(title, 
 		windowPos, 
 		windowPos, 
 		window_w, 
 		window_h, 
 		SDL_WINDOW_SHOWN );
+	if(renderer.sdl_window == NULL) {
+		printf("Could not create window: %s\n", SDL_GetError());
+		return 0;
+	}
+	Startup::phase_end();
 
+	Startup::phase_begin("SDL_CreateRenderer");
 	Uint32 flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
 	// Uint32 flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE;
 	renderer.renderer = SDL_CreateRenderer(renderer.sdl_window, -1, flags);
+	if(renderer.renderer == NULL) {
+		// no accelerated renderer, e.g. with SDL_VIDEODRIVER=dummy on a CI machine
+		renderer.renderer = SDL_CreateRenderer(renderer.sdl_window, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+	}
+	if(renderer.renderer == NULL) {
+		printf("Could not create renderer: %s\n", SDL_GetError());
+		return 0;
+	}
+	Startup::phase_end();
 
     renderer.clearColor = { 0, 0, 0, 255 };
 	SDL_SetRenderDrawColor(renderer.renderer, 0x00, 0x00, 0x00, 0xFF ); 
 	
 	// Font init
+	Startup::phase_begin("TTF_Init");
 	TTF_Init();
+	Startup::phase_end();
 
 	//Initialize PNG loading 
+	Startup::phase_begin("IMG_Init");
 	int imgFlags = IMG_INIT_PNG; 
 	if( !( IMG_Init( imgFlags ) & imgFlags ) ) { 
 		printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() ); 
 		abort();
 	}
+	Startup::phase_end();
 
     SDL_ShowCursor(SDL_DISABLE);
     
@@ -291,8 +758,10 @@ int renderer_init(const char *title, unsigned vw, unsigned vh, unsigned scale) {
 	}
 	window_set_position(windowPos, windowPos);
     
+	Startup::phase_begin("render_target");
 	SDL_Texture *target = SDL_CreateTexture(renderer.renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, gw, gh);
 	renderer.renderTarget = target;
+	Startup::phase_end();
 	
     return 1;
 }
@@ -0,0 +1,223 @@
+#include "vec2.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define VEC2_SSE2
+	#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define VEC2_NEON
+	#include <arm_neon.h>
+#endif
+
+// The vector paths only use separate multiplies and adds in the order of the
+// scalar code, so every path rounds the same and the simulation stays
+// deterministic across them.
+namespace Batch {
+	// Entity fields are only 8 of every stride bytes, a vector load has to be
+	// put together from two halves and costs more than the scalar adds. The
+	// vector paths are for packed arrays, strided ones take the scalar loop.
+	void add(Vec2f *out, const Vec2f *a, const Vec2f *b, size_t n, size_t stride) {
+		size_t i = 0;
+		if(stride == sizeof(Vec2f)) {
+			// two vectors per register
+#if defined(VEC2_SSE2)
+			for(; i + 2 <= n; i += 2) {
+				_mm_storeu_ps(&out[i].x, _mm_add_ps(_mm_loadu_ps(&a[i].x), _mm_loadu_ps(&b[i].x)));
+			}
+#elif defined(VEC2_NEON)
+			for(; i + 2 <= n; i += 2) {
+				vst1q_f32(&out[i].x, vaddq_f32(vld1q_f32(&a[i].x), vld1q_f32(&b[i].x)));
+			}
+#endif
+		}
+		for(; i < n; ++i) {
+			at(out, i, stride) = at(a, i, stride) + at(b, i, stride);
+		}
+	}
+
+	void scale(Vec2f *out, const Vec2f *a, float s, size_t n, size_t stride) {
+		size_t i = 0;
+		if(stride == sizeof(Vec2f)) {
+#if defined(VEC2_SSE2)
+			const __m128 vs = _mm_set1_ps(s);
+			for(; i + 2 <= n; i += 2) {
+				_mm_storeu_ps(&out[i].x, _mm_mul_ps(_mm_loadu_ps(&a[i].x), vs));
+			}
+#elif defined(VEC2_NEON)
+			for(; i + 2 <= n; i += 2) {
+				vst1q_f32(&out[i].x, vmulq_n_f32(vld1q_f32(&a[i].x), s));
+			}
+#endif
+		}
+		for(; i < n; ++i) {
+			at(out, i, stride) = at(a, i, stride) * s;
+		}
+	}
+
+	void length_sq(float *out, const Vec2f *a, size_t n, size_t stride) {
+		size_t i = 0;
+		if(stride == sizeof(Vec2f)) {
+			// four vectors, split into x and y registers
+#if defined(VEC2_SSE2)
+			for(; i + 4 <= n; i += 4) {
+				__m128 v01 = _mm_loadu_ps(&a[i].x);
+				__m128 v23 = _mm_loadu_ps(&a[i + 2].x);
+				__m128 x = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 y = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1));
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+			}
+#elif defined(VEC2_NEON)
+			for(; i + 4 <= n; i += 4) {
+				float32x4x2_t v = vld2q_f32(&a[i].x);
+				vst1q_f32(out + i, vaddq_f32(vmulq_f32(v.val[0], v.val[0]), vmulq_f32(v.val[1], v.val[1])));
+			}
+#endif
+		}
+		for(; i < n; ++i) {
+			out[i] = Math::length_sq(at(a, i, stride));
+		}
+	}
+
+	void overlap_mask(uint64_t *mask, Vec2f center, float radius, const Vec2f *centers, const float *radii, size_t n) {
+#if defined(VEC2_SSE2)
+		const __m128 cx = _mm_set1_ps(center.x);
+		const __m128 cy = _mm_set1_ps(center.y);
+		const __m128 cr = _mm_set1_ps(radius);
+#elif defined(VEC2_NEON)
+		const float32x4_t cx = vdupq_n_f32(center.x);
+		const float32x4_t cy = vdupq_n_f32(center.y);
+		const float32x4_t cr = vdupq_n_f32(radius);
+		const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+		const uint32x4_t lanes = vld1q_u32(lane_bits);
+#endif
+		for(size_t word = 0; word < mask_words(n); ++word) {
+			size_t i = word * 64;
+			size_t end = std::min(n, i + 64);
+			uint64_t bits = 0;
+			// four circles per step
+#if defined(VEC2_SSE2)
+			for(; i + 4 <= end; i += 4) {
+				__m128 v01 = _mm_loadu_ps(&centers[i].x);
+				__m128 v23 = _mm_loadu_ps(&centers[i + 2].x);
+				__m128 dx = _mm_sub_ps(_mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0)), cx);
+				__m128 dy = _mm_sub_ps(_mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1)), cy);
+				__m128 distance_sq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+				__m128 r = _mm_add_ps(cr, _mm_loadu_ps(radii + i));
+				bits |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(distance_sq, _mm_mul_ps(r, r))) << (i % 64);
+			}
+#elif defined(VEC2_NEON)
+			for(; i + 4 <= end; i += 4) {
+				float32x4x2_t v = vld2q_f32(&centers[i].x);
+				float32x4_t dx = vsubq_f32(v.val[0], cx);
+				float32x4_t dy = vsubq_f32(v.val[1], cy);
+				float32x4_t distance_sq = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+				float32x4_t r = vaddq_f32(cr, vld1q_f32(radii + i));
+				bits |= (uint64_t)vaddvq_u32(vandq_u32(vcltq_f32(distance_sq, vmulq_f32(r, r)), lanes)) << (i % 64);
+			}
+#endif
+			for(; i < end; ++i) {
+				if(Math::intersect_circles(center, radius, centers[i], radii[i])) {
+					bits |= 1ULL << (i % 64);
+				}
+			}
+			mask[word] = bits;
+		}
+	}
+
+	// Branches of Math::sweep_circles become lane selects, same operations in
+	// the same order
+	void sweep_mask(uint64_t *mask, Vec2f center, Vec2f velocity, float radius, const Vec2f *centers, const Vec2f *velocities, const float *radii, float max_speed, size_t n) {
+		// nothing further than this plus the radii can touch, a pixel over so
+		// rounding never skips a hit
+		const float pad = fabsf(velocity.x) + fabsf(velocity.y) + max_speed + 1.0f;
+#if defined(VEC2_SSE2)
+		const __m128 cx = _mm_set1_ps(center.x);
+		const __m128 cy = _mm_set1_ps(center.y);
+		const __m128 vx = _mm_set1_ps(velocity.x);
+		const __m128 vy = _mm_set1_ps(velocity.y);
+		const __m128 cr = _mm_set1_ps(radius);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 cpad = _mm_set1_ps(radius + pad);
+#elif defined(VEC2_NEON)
+		const float32x4_t cx = vdupq_n_f32(center.x);
+		const float32x4_t cy = vdupq_n_f32(center.y);
+		const float32x4_t vx = vdupq_n_f32(velocity.x);
+		const float32x4_t vy = vdupq_n_f32(velocity.y);
+		const float32x4_t cr = vdupq_n_f32(radius);
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		const float32x4_t cpad = vdupq_n_f32(radius + pad);
+		const uint32_t lane_bits[4] = { 1, 2, 4, 8 };
+		const uint32x4_t lanes = vld1q_u32(lane_bits);
+#endif
+		for(size_t word = 0; word < mask_words(n); ++word) {
+			size_t i = word * 64;
+			size_t end = std::min(n, i + 64);
+			uint64_t bits = 0;
+			// four circles per step, skipped when none is within reach
+#if defined(VEC2_SSE2)
+			for(; i + 4 <= end; i += 4) {
+				__m128 c01 = _mm_loadu_ps(&centers[i].x);
+				__m128 c23 = _mm_loadu_ps(&centers[i + 2].x);
+				__m128 dx = _mm_sub_ps(_mm_shuffle_ps(c01, c23, _MM_SHUFFLE(2, 0, 2, 0)), cx);
+				__m128 dy = _mm_sub_ps(_mm_shuffle_ps(c01, c23, _MM_SHUFFLE(3, 1, 3, 1)), cy);
+				__m128 radii4 = _mm_loadu_ps(radii + i);
+				__m128 reach = _mm_add_ps(cpad, radii4);
+				if(_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(reach, reach))) == 0) {
+					continue;
+				}
+				__m128 v01 = _mm_loadu_ps(&velocities[i].x);
+				__m128 v23 = _mm_loadu_ps(&velocities[i + 2].x);
+				__m128 wx = _mm_sub_ps(_mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0)), vx);
+				__m128 wy = _mm_sub_ps(_mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1)), vy);
+				__m128 r = _mm_add_ps(cr, radii4);
+				__m128 far = _mm_or_ps(
+					_mm_cmpgt_ps(_mm_andnot_ps(sign, dx), _mm_add_ps(r, _mm_andnot_ps(sign, wx))),
+					_mm_cmpgt_ps(_mm_andnot_ps(sign, dy), _mm_add_ps(r, _mm_andnot_ps(sign, wy))));
+				__m128 dw = _mm_add_ps(_mm_mul_ps(dx, wx), _mm_mul_ps(dy, wy));
+				__m128 ww = _mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy));
+				__m128 whole = _mm_cmpge_ps(dw, ww);
+				__m128 part = _mm_and_ps(_mm_cmpgt_ps(dw, zero), _mm_div_ps(dw, ww));
+				__m128 s = _mm_or_ps(_mm_and_ps(whole, one), _mm_andnot_ps(whole, part));
+				__m128 px = _mm_sub_ps(dx, _mm_mul_ps(wx, s));
+				__m128 py = _mm_sub_ps(dy, _mm_mul_ps(wy, s));
+				__m128 hit = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(r, r));
+				bits |= (uint64_t)_mm_movemask_ps(_mm_andnot_ps(far, hit)) << (i % 64);
+			}
+#elif defined(VEC2_NEON)
+			for(; i + 4 <= end; i += 4) {
+				float32x4x2_t c = vld2q_f32(&centers[i].x);
+				float32x4_t dx = vsubq_f32(c.val[0], cx);
+				float32x4_t dy = vsubq_f32(c.val[1], cy);
+				float32x4_t radii4 = vld1q_f32(radii + i);
+				float32x4_t reach = vaddq_f32(cpad, radii4);
+				if(vmaxvq_u32(vcltq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(reach, reach))) == 0) {
+					continue;
+				}
+				float32x4x2_t v = vld2q_f32(&velocities[i].x);
+				float32x4_t wx = vsubq_f32(v.val[0], vx);
+				float32x4_t wy = vsubq_f32(v.val[1], vy);
+				float32x4_t r = vaddq_f32(cr, radii4);
+				uint32x4_t far = vorrq_u32(
+					vcgtq_f32(vabsq_f32(dx), vaddq_f32(r, vabsq_f32(wx))),
+					vcgtq_f32(vabsq_f32(dy), vaddq_f32(r, vabsq_f32(wy))));
+				float32x4_t dw = vaddq_f32(vmulq_f32(dx, wx), vmulq_f32(dy, wy));
+				float32x4_t ww = vaddq_f32(vmulq_f32(wx, wx), vmulq_f32(wy, wy));
+				float32x4_t part = vbslq_f32(vcgtq_f32(dw, zero), vdivq_f32(dw, ww), zero);
+				float32x4_t s = vbslq_f32(vcgeq_f32(dw, ww), one, part);
+				float32x4_t px = vsubq_f32(dx, vmulq_f32(wx, s));
+				float32x4_t py = vsubq_f32(dy, vmulq_f32(wy, s));
+				uint32x4_t hit = vcltq_f32(vaddq_f32(vmulq_f32(px, px), vmulq_f32(py, py)), vmulq_f32(r, r));
+				bits |= (uint64_t)vaddvq_u32(vandq_u32(vbicq_u32(hit, far), lanes)) << (i % 64);
+			}
+#endif
+			for(; i < end; ++i) {
+				if(Math::sweep_circles(center, velocity, radius, centers[i], velocities[i], radii[i])) {
+					bits |= 1ULL << (i % 64);
+				}
+			}
+			mask[word] = bits;
+		}
+	}
+}
@@ -0,0 +1,199 @@
+// Steady state allocation check
+// Replaces the global operator new/delete with counting versions, runs the
+// simulation alone and then with rendering on the SDL dummy video driver, and
+// fails if anything allocates per tick or per frame once warmed up.
+// usage: alloccheck [warmup frames] [measured frames]
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include <cstdlib>
+#include <new>
+#include <cstring>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <dbghelp.h>
+	#pragma comment(lib, "dbghelp.lib")
+#else
+	#include <execinfo.h>
+#endif
+
+namespace AllocTracking {
+	static const int MAX_FRAMES = 12;
+	static const unsigned MAX_SITES = 64;
+
+	struct Site {
+		void *frames[MAX_FRAMES];
+		int frame_n;
+		unsigned count;
+	};
+
+	// everything is static, recording must not allocate itself
+	static bool enabled = false;
+	static bool recording = false;
+	static unsigned long long count = 0;
+	static Site sites[MAX_SITES];
+	static unsigned site_n = 0;
+	static unsigned sites_dropped = 0;
+
+	static int capture(void **frames) {
+#ifdef _WIN32
+		return CaptureStackBackTrace(2, MAX_FRAMES, frames, NULL);
+#else
+		return backtrace(frames, MAX_FRAMES);
+#endif
+	}
+
+	static void record() {
+		if(!enabled || recording) {
+			return;
+		}
+		// backtrace can allocate the first time it is used
+		recording = true;
+		count++;
+		Site site;
+		site.frame_n = capture(site.frames);
+		site.count = 1;
+		bool found = false;
+		for(unsigned i = 0; i < site_n && !found; ++i) {
+			if(sites[i].frame_n == site.frame_n && memcmp(sites[i].frames, site.frames, site.frame_n * sizeof(void*)) == 0) {
+				sites[i].count++;
+				found = true;
+			}
+		}
+		if(!found) {
+			if(site_n < MAX_SITES) {
+				sites[site_n++] = site;
+			} else {
+				sites_dropped++;
+			}
+		}
+		recording = false;
+	}
+
+	static void reset() {
+		count = 0;
+		site_n = 0;
+		sites_dropped = 0;
+	}
+
+	static void print_sites() {
+#ifdef _WIN32
+		HANDLE process = GetCurrentProcess();
+		SymInitialize(process, NULL, TRUE);
+		SymSetOptions(SYMOPT_LOAD_LINES | SYMOPT_UNDNAME);
+#endif
+		for(unsigned i = 0; i < site_n; ++i) {
+			printf("  %u allocations from:\n", sites[i].count);
+#ifdef _WIN32
+			char buffer[sizeof(SYMBOL_INFO) + 256];
+			SYMBOL_INFO *symbol = (SYMBOL_INFO*)buffer;
+			for(int f = 0; f < sites[i].frame_n; ++f) {
+				memset(buffer, 0, sizeof(buffer));
+				symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+				symbol->MaxNameLen = 255;
+				DWORD64 address = (DWORD64)sites[i].frames[f];
+				IMAGEHLP_LINE64 line = {};
+				line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+				DWORD displacement = 0;
+				if(SymFromAddr(process, address, NULL, symbol)) {
+					if(SymGetLineFromAddr64(process, address, &displacement, &line)) {
+						printf("    %s (%s:%lu)\n", symbol->Name, line.FileName, line.LineNumber);
+					} else {
+						printf("    %s\n", symbol->Name);
+					}
+				} else {
+					printf("    0x%llx\n", (unsigned long long)address);
+				}
+			}
+#else
+			fflush(stdout);
+			backtrace_symbols_fd(sites[i].frames, sites[i].frame_n, 1);
+#endif
+		}
+		if(sites_dropped > 0) {
+			printf("  (%u more call sites not recorded)\n", sites_dropped);
+		}
+#ifdef _WIN32
+		SymCleanup(process);
+#endif
+	}
+}
+
+static void *counted_alloc(size_t size) {
+	AllocTracking::record();
+	void *p = malloc(size > 0 ? size : 1);
+	if(p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new(size_t size) { return counted_alloc(size); }
+void *operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static void tick() {
+	Input::update_states();
+	SDL_Event event;
+	while (SDL_PollEvent(&event)) {
+		Input::map(&event);
+	}
+	Engine::update();
+	Time::delta_time = Engine::is_paused() ? 0.0f : Time::delta_time_raw;
+	asteroids_update();
+}
+
+static bool measure(const char *name, bool render, int warmup, int frames) {
+	for(int i = 0; i < warmup + frames; ++i) {
+		if(i == warmup) {
+			AllocTracking::reset();
+			AllocTracking::enabled = true;
+		}
+		tick();
+		if(render) {
+			asteroids_render();
+		}
+		Engine::frame_reset();
+	}
+	AllocTracking::enabled = false;
+
+	const char *unit = render ? "frame" : "tick";
+	printf("%s: %llu allocations in %d %ss (%.3f per %s)\n", name, AllocTracking::count, frames, unit,
+		(double)AllocTracking::count / frames, unit);
+	AllocTracking::print_sites();
+	return AllocTracking::count == 0;
+}
+
+int main(int argc, char* argv[]) {
+	int warmup = argc > 1 ? atoi(argv[1]) : 300;
+	int frames = argc > 2 ? atoi(argv[2]) : 3000;
+
+	// runs without a display unless the driver is set explicitly
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+	if(!renderer_init("ASTEROIDS alloccheck", 640, 360, 1)) {
+		printf("init renderer failed");
+		return 1;
+	}
+	Engine::init();
+	asteroids_load();
+
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / 60.0f;
+
+	bool sim_ok = measure("simulation", false, warmup, frames);
+	bool render_ok = measure("simulation + render", true, warmup, frames);
+
+	renderer_destroy();
+
+	if(!sim_ok || !render_ok) {
+		printf("FAILED: steady state allocates\n");
+		return 1;
+	}
+	printf("OK: no steady state allocations\n");
+	return 0;
+}
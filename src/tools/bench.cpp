@@ -0,0 +1,689 @@
+// Micro benchmarks of the simulation and renderer, each benchmark is warmed
+// up, timed in batches and the median time per call is reported with a 95%
+// confidence interval.
+// With --baseline it is a regression gate: a benchmark fails when its median
+// is more than the threshold slower than the baseline and the confidence
+// intervals do not overlap, and the exit code is 1.
+// --runs n measures everything n times over and keeps the fastest median with
+// an interval covering all runs, so the noise between runs on a machine is in
+// the baseline and a gate does not fail on it.
+// usage: bench [name filter] [--samples n] [--warmup ms] [--pin cpu] [--render]
+//              [--runs n] [--baseline file] [--threshold percent]
+//              [--write-baseline file]
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include "replay.h"
+#include "flight_recorder.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#elif defined(__linux__)
+	#include <sched.h>
+#endif
+
+namespace Bench {
+	static const double SAMPLE_TARGET_NS = 2e6;
+
+	struct Benchmark {
+		const char *name;
+		std::function<void()> setup;
+		std::function<void()> run;
+	};
+
+	struct Result {
+		std::string name;
+		double median_ns;
+		double ci_low_ns;
+		double ci_high_ns;
+	};
+
+	struct Options {
+		int samples = 31;
+		double warmup_ms = 100.0;
+		double threshold_percent = 10.0;
+		int runs = 1;
+	};
+
+	static std::vector<Benchmark> benchmarks;
+
+	static void add(const char *name, std::function<void()> setup, std::function<void()> run) {
+		benchmarks.push_back({ name, setup, run });
+	}
+
+	static double time_batch(const Benchmark &b, int iterations) {
+		auto start = std::chrono::steady_clock::now();
+		for(int i = 0; i < iterations; ++i) {
+			b.run();
+		}
+		auto end = std::chrono::steady_clock::now();
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+
+	// Median ns per call and its confidence interval from order statistics,
+	// which holds whatever the distribution of the samples is
+	static Result measure(const Benchmark &b, const Options &options) {
+		b.setup();
+		// grow the batch until one sample takes long enough to time reliably
+		int iterations = 1;
+		while(iterations < (1 << 24) && time_batch(b, iterations) < SAMPLE_TARGET_NS) {
+			iterations *= 2;
+		}
+		// caches, branch predictors and the clock speed settle first
+		auto warmup_start = std::chrono::steady_clock::now();
+		while(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warmup_start).count() < options.warmup_ms) {
+			time_batch(b, iterations);
+		}
+		int n = options.samples;
+		std::vector<double> samples(n);
+		for(int i = 0; i < n; ++i) {
+			samples[i] = time_batch(b, iterations) / iterations;
+		}
+		std::sort(samples.begin(), samples.end());
+		double spread = 1.96 * std::sqrt((double)n) / 2.0;
+		int low = std::max(0, (int)std::floor(n / 2.0 - spread) - 1);
+		int high = std::min(n - 1, (int)std::ceil(1.0 + n / 2.0 + spread) - 1);
+		return { b.name, samples[n / 2], samples[low], samples[high] };
+	}
+
+	// Runs go over every benchmark in turn, so a slow patch of the machine is
+	// spread over all of them instead of landing on one
+	static std::vector<Result> run_all(const char *filter, const Options &options) {
+		std::vector<Result> results;
+		for(int run = 0; run < options.runs; ++run) {
+			if(options.runs > 1) {
+				printf("run %d of %d\n", run + 1, options.runs);
+			}
+			size_t i = 0;
+			for(auto &b : benchmarks) {
+				if(filter && strstr(b.name, filter) == NULL) {
+					continue;
+				}
+				Result r = measure(b, options);
+				if(run == 0) {
+					results.push_back(r);
+				} else {
+					Result &all = results[i];
+					all.median_ns = std::min(all.median_ns, r.median_ns);
+					all.ci_low_ns = std::min(all.ci_low_ns, r.ci_low_ns);
+					all.ci_high_ns = std::max(all.ci_high_ns, r.ci_high_ns);
+				}
+				i++;
+			}
+		}
+		for(const Result &r : results) {
+			printf("%-36s %12.1f ns  [%.1f, %.1f]\n", r.name.c_str(), r.median_ns, r.ci_low_ns, r.ci_high_ns);
+		}
+		return results;
+	}
+
+	// Keeps the run on one core, so it is not moved mid sample
+	static bool pin_cpu(int cpu) {
+#ifdef _WIN32
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+		return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	// Timings only compare between the same compiler, settings and simulation
+	static std::string build_description() {
+		std::string build;
+#if defined(_MSC_VER)
+		build = "msvc " + std::to_string(_MSC_FULL_VER);
+#elif defined(__clang__)
+		build = "clang " __clang_version__;
+#elif defined(__GNUC__)
+		build = "gcc " __VERSION__;
+#else
+		build = "unknown compiler";
+#endif
+#if defined(_DEBUG)
+		build += ", debug";
+#elif defined(__OPTIMIZE__) || defined(NDEBUG)
+		build += ", optimized";
+#endif
+#ifdef ASTEROIDS_FIXED_POINT
+		build += ", fixed point";
+#else
+		build += ", float";
+#endif
+		return build;
+	}
+
+	static bool write_baseline(const std::string &path, const std::vector<Result> &results) {
+		std::ofstream file(path);
+		if(!file) {
+			return false;
+		}
+		file << "{\n\t\"build\": \"" << build_description() << "\",\n\t\"benchmarks\": [\n";
+		for(size_t i = 0; i < results.size(); ++i) {
+			const Result &r = results[i];
+			file << "\t\t{ \"name\": \"" << r.name << "\", \"median_ns\": " << r.median_ns
+				<< ", \"ci_low_ns\": " << r.ci_low_ns << ", \"ci_high_ns\": " << r.ci_high_ns << " }"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		file << "\t]\n}\n";
+		return (bool)file;
+	}
+
+	// String value after "key": in text from pos, empty if missing
+	static std::string json_string(const std::string &text, const char *key, size_t pos, size_t *end = NULL) {
+		std::string pattern = std::string("\"") + key + "\": \"";
+		size_t start = text.find(pattern, pos);
+		if(start == std::string::npos) {
+			return std::string();
+		}
+		start += pattern.size();
+		size_t stop = text.find('"', start);
+		if(end) {
+			*end = stop;
+		}
+		return text.substr(start, stop - start);
+	}
+
+	static double json_number(const std::string &text, const char *key, size_t pos) {
+		std::string pattern = std::string("\"") + key + "\": ";
+		size_t start = text.find(pattern, pos);
+		return start == std::string::npos ? 0.0 : strtod(text.c_str() + start + pattern.size(), NULL);
+	}
+
+	// Reads what write_baseline wrote, not general json
+	static bool read_baseline(const std::string &path, std::string &build, std::vector<Result> &results) {
+		std::ifstream file(path);
+		if(!file) {
+			return false;
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		std::string text = buffer.str();
+		build = json_string(text, "build", 0);
+		size_t pos = 0;
+		for(;;) {
+			size_t end = 0;
+			std::string name = json_string(text, "name", pos, &end);
+			if(name.empty()) {
+				break;
+			}
+			results.push_back({ name, json_number(text, "median_ns", end), json_number(text, "ci_low_ns", end), json_number(text, "ci_high_ns", end) });
+			pos = end;
+		}
+		return !results.empty();
+	}
+
+	// Number of regressions
+	static int compare(const std::vector<Result> &results, const std::vector<Result> &baseline, const Options &options) {
+		int regressions = 0;
+		printf("\n%-36s %12s %12s %9s\n", "benchmark", "baseline ns", "now ns", "change");
+		for(const Result &r : results) {
+			const Result *base = NULL;
+			for(const Result &b : baseline) {
+				if(b.name == r.name) {
+					base = &b;
+				}
+			}
+			if(base == NULL) {
+				printf("%-36s %12s %12.1f %9s\n", r.name.c_str(), "-", r.median_ns, "new");
+				continue;
+			}
+			double change = (r.median_ns / base->median_ns - 1.0) * 100.0;
+			const char *verdict = "";
+			if(change > options.threshold_percent && r.ci_low_ns > base->ci_high_ns) {
+				verdict = "REGRESSION";
+				regressions++;
+			} else if(change < -options.threshold_percent && r.ci_high_ns < base->ci_low_ns) {
+				verdict = "faster";
+			}
+			printf("%-36s %12.1f %12.1f %+8.1f%% %s\n", r.name.c_str(), base->median_ns, r.median_ns, change, verdict);
+		}
+		return regressions;
+	}
+}
+
+static const uint32_t BENCH_SEED = 1;
+static WorldSnapshot snapshot;
+static const int RANDOM_COUNT = 1024;
+static float random_floats[RANDOM_COUNT];
+static RandomGenerator rng;
+static const int VEC2_COUNT = 1024;
+static Vec2f vec2_a[VEC2_COUNT];
+static Vec2f vec2_b[VEC2_COUNT];
+static float vec2_radii[VEC2_COUNT];
+static uint64_t vec2_mask[VEC2_COUNT / 64];
+
+// A ring of radius 32 with a disc inside its hole, the boxes overlap
+// everywhere and no pixel does, so the tests scan it all
+static Bitmask::Mask ring;
+static Bitmask::Mask disc;
+static Bitmask::Mask turned;
+
+// Stand-in for ship.png masks, headless runs load no sprites. A 16x16
+// arrow so the rotations differ.
+static SpriteMasks arrow_masks;
+
+static void bitmask_setup() {
+	ring = Bitmask::make(64, 64);
+	for(int y = 0; y < 64; ++y) {
+		for(int x = 0; x < 64; ++x) {
+			float dx = x + 0.5f - 32.0f;
+			float dy = y + 0.5f - 32.0f;
+			float d = dx * dx + dy * dy;
+			if(d < 32.0f * 32.0f && d >= 28.0f * 28.0f) {
+				Bitmask::set(ring, x, y);
+			}
+		}
+	}
+	disc = Bitmask::circle(Fixed(24));
+}
+
+static void arrow_masks_setup() {
+	if(!arrow_masks.rotations.empty()) {
+		return;
+	}
+	uint8_t alpha[16 * 16];
+	for(int i = 0; i < 16 * 16; ++i) {
+		int x = i % 16;
+		int y = i / 16;
+		alpha[i] = 2 * std::abs(2 * x - 15) <= 2 * y + 1 ? 255 : 0;
+	}
+	Bitmask::Mask arrow = Bitmask::from_alpha(alpha, 16, 16);
+	for(int i = 0; i < PixelCollisions::SHIP_ROTATIONS; ++i) {
+		arrow_masks.rotations.push_back(Bitmask::rotated(arrow, Fixed(i * 360) / Fixed(PixelCollisions::SHIP_ROTATIONS)));
+	}
+}
+
+// A game some seconds in, the state a rollback would normally save
+static void world_typical() {
+	world.config = AsteroidsConfig();
+	asteroids_new_game(BENCH_SEED);
+	uint8_t inputs[2] = { INPUT_UP | INPUT_FIRE, INPUT_LEFT | INPUT_FIRE };
+	for(int i = 0; i < 300; ++i) {
+		asteroids_tick(inputs);
+	}
+	world_save(snapshot);
+}
+
+// Every entity array at capacity
+static void world_full() {
+	world.config = AsteroidsConfig();
+	asteroids_new_game(BENCH_SEED);
+	world.ship_n = (unsigned)world.ships.size();
+	world.asteroid_n = (unsigned)world.asteroids.size();
+	world.bullets_n = (unsigned)world.bullets.size();
+	world.event_n = (unsigned)world.event_queue.size();
+	world_save(snapshot);
+}
+
+// Capacity asteroids and bullets laid out so that no pair overlaps, most
+// pairs miss in a real game too
+static void world_spread() {
+	world.config = AsteroidsConfig();
+	asteroids_new_game(BENCH_SEED);
+	world.asteroid_n = GameWorld::MAX_ASTEROIDS;
+	for(unsigned i = 0; i < world.asteroid_n; ++i) {
+		Asteroid &a = world.asteroids[i];
+		a.position.x = (float)(i % 20 * 32 + 16);
+		a.position.y = (float)(i / 20 * 60 + 60);
+		a.velocity.x = a.velocity.y = 0;
+		a.size = 3;
+	}
+	world.bullets_n = GameWorld::MAX_BULLETS;
+	for(unsigned i = 0; i < world.bullets_n; ++i) {
+		Bullet &b = world.bullets[i];
+		b.position.x = (float)(i % 500);
+		b.position.y = (float)(i / 500 * 10 + 10);
+		b.velocity.x = b.velocity.y = 0;
+		b.radius = 1;
+		b.time_to_live = 1;
+		b.faction = 0;
+	}
+}
+
+// Every ship slot filled, two players and sentry bots, some seconds in
+static void world_bots() {
+	world.config = AsteroidsConfig();
+	world.config.bot_count = GameWorld::MAX_SHIPS - 2;
+	world.config.bot_pilot = PILOT_SENTRY;
+	asteroids_new_game(BENCH_SEED);
+	uint8_t inputs[2] = { INPUT_UP | INPUT_FIRE, INPUT_LEFT | INPUT_FIRE };
+	for(int i = 0; i < 300; ++i) {
+		asteroids_tick(inputs);
+	}
+	world_save(snapshot);
+}
+
+// world_bots with ships colliding by their masks from here on
+static void world_bots_pixels() {
+	arrow_masks_setup();
+	PixelCollisions::ship_masks = &arrow_masks;
+	world_bots();
+	world.config.pixel_collisions = true;
+	world_save(snapshot);
+}
+
+// world_bots with the systems before handle_events run, in asteroids_tick
+// order, so the snapshot has a full event queue
+static void world_bots_events() {
+	world_bots();
+	uint8_t inputs[2] = { INPUT_UP | INPUT_FIRE, INPUT_LEFT | INPUT_FIRE };
+	system_asteroid_spawn();
+	system_shield();
+	system_player_input(inputs);
+	system_player_movement();
+	system_forward_movement();
+	system_keep_in_bounds();
+	system_collisions();
+	world_save(snapshot);
+}
+
+// world_bots with five asteroids and every ship in the middle, so each ship
+// is hit by each asteroid in the same tick
+static void world_pileup() {
+	world_bots();
+	Vec2 center = { gw / 2.0f, gh / 2.0f };
+	world.asteroid_n = std::min(world.asteroid_n, 5u);
+	for(unsigned i = 0; i < world.asteroid_n; ++i) {
+		world.asteroids[i].position = center;
+	}
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		world.ships[i].position = center;
+		world.ships[i].inactive_timer = 0;
+		world.ships[i].shield.active_timer = 0;
+	}
+	world_save(snapshot);
+}
+
+// world_pileup queueing every hit
+static void world_pileup_unmerged() {
+	world_pileup();
+	for(uint8_t &rule : world.config.event_merge) {
+		rule = EVENT_MERGE_NONE;
+	}
+	world_save(snapshot);
+}
+
+// The system benchmarks change the world, so each call restores the snapshot
+// first, world_restore/* is that part of the time
+static void register_system_benchmarks() {
+	static uint8_t inputs[2] = { INPUT_UP | INPUT_FIRE, INPUT_LEFT | INPUT_FIRE };
+	Bench::add("system/collisions_typical", world_typical, [] {
+		world_restore(snapshot);
+		system_collisions();
+	});
+	Bench::add("system/collisions_bots", world_bots, [] {
+		world_restore(snapshot);
+		system_collisions();
+	});
+	Bench::add("system/collisions_bots_pixels", world_bots_pixels, [] {
+		world_restore(snapshot);
+		system_collisions();
+	});
+	Bench::add("system/player_input_bots", world_bots, [] {
+		world_restore(snapshot);
+		system_player_input(inputs);
+	});
+	Bench::add("system/player_movement_bots", world_bots, [] {
+		world_restore(snapshot);
+		system_player_movement();
+	});
+	Bench::add("system/handle_events_bots", world_bots_events, [] {
+		world_restore(snapshot);
+		handle_events();
+	});
+	// ship hits merged per ship, against queueing each one
+	Bench::add("system/collisions_events_pileup", world_pileup, [] {
+		world_restore(snapshot);
+		system_collisions();
+		handle_events();
+	});
+	Bench::add("system/collisions_events_pileup_unmerged", world_pileup_unmerged, [] {
+		world_restore(snapshot);
+		system_collisions();
+		handle_events();
+	});
+	Bench::add("tick/typical", world_typical, [] {
+		world_restore(snapshot);
+		asteroids_tick(inputs);
+	});
+	Bench::add("tick/bots", world_bots, [] {
+		world_restore(snapshot);
+		asteroids_tick(inputs);
+	});
+}
+
+// Needs asteroids_load, so only with --render
+static void register_render_benchmarks() {
+	Bench::add("render/typical", world_typical, [] {
+		asteroids_render();
+		Engine::frame_reset();
+	});
+	Bench::add("render/bots", world_bots, [] {
+		asteroids_render();
+		Engine::frame_reset();
+	});
+}
+
+static void register_benchmarks() {
+	Bench::add("world_save/typical", world_typical, [] { world_save(snapshot); });
+	Bench::add("world_restore/typical", world_typical, [] { world_restore(snapshot); });
+	Bench::add("world_save/full", world_full, [] { world_save(snapshot); });
+	Bench::add("world_restore/full", world_full, [] { world_restore(snapshot); });
+	// the always on flight recorder, averaged over its snapshot interval
+	Bench::add("flight_recorder/tick", [] {
+		world_typical();
+		FlightRecorder::start("bench_crash.rpl");
+	}, [] {
+		uint8_t inputs[2] = { INPUT_UP, INPUT_FIRE };
+		FlightRecorder::record_tick(inputs);
+	});
+	// 1024 floats each, the std version is what RNG::range_f used to do
+	Bench::add("rng/std_uniform_real_1024", [] {}, [] {
+		static std::mt19937 engine(BENCH_SEED);
+		for(int i = 0; i < RANDOM_COUNT; ++i) {
+			std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+			random_floats[i] = dist(engine);
+		}
+	});
+	Bench::add("rng/range_f_1024", [] { rng.seed(BENCH_SEED); }, [] {
+		for(int i = 0; i < RANDOM_COUNT; ++i) {
+			random_floats[i] = RNG::range_f(rng, 0.0f, 1.0f);
+		}
+	});
+	Bench::add("rng/fill_range_f_1024", [] { rng.seed(BENCH_SEED); }, [] {
+		RNG::fill_range_f(rng, random_floats, RANDOM_COUNT, 0.0f, 1.0f);
+	});
+	Bench::add("rng/stream_1024", [] {}, [] {
+		static uint64_t counter = 0;
+		RandomStream stream = RNG::stream(BENCH_SEED, 1);
+		for(int i = 0; i < RANDOM_COUNT; ++i) {
+			random_floats[i] = RNG::range_f_at(stream, counter++, 0.0f, 1.0f);
+		}
+	});
+	// 1024 float vectors each, the loops are what the batch functions replace
+	auto vec2_setup = [] {
+		rng.seed(BENCH_SEED);
+		RNG::fill_range_f(rng, &vec2_a[0].x, 2 * VEC2_COUNT, 0.0f, 640.0f);
+		RNG::fill_range_f(rng, &vec2_b[0].x, 2 * VEC2_COUNT, -1.0f, 1.0f);
+		RNG::fill_range_f(rng, vec2_radii, VEC2_COUNT, 1.0f, 32.0f);
+	};
+	Bench::add("vec2/add_loop_1024", vec2_setup, [] {
+		for(int i = 0; i < VEC2_COUNT; ++i) {
+			vec2_a[i] += vec2_b[i];
+		}
+	});
+	Bench::add("vec2/add_1024", vec2_setup, [] {
+		Batch::add(vec2_a, vec2_a, vec2_b, VEC2_COUNT);
+	});
+	Bench::add("vec2/intersect_circles_loop_1024", vec2_setup, [] {
+		memset(vec2_mask, 0, sizeof(vec2_mask));
+		for(int i = 0; i < VEC2_COUNT; ++i) {
+			if(Math::intersect_circles(vec2_b[0], 1.0f, vec2_a[i], vec2_radii[i])) {
+				vec2_mask[i / 64] |= 1ULL << (i % 64);
+			}
+		}
+	});
+	Bench::add("vec2/overlap_mask_1024", vec2_setup, [] {
+		Batch::overlap_mask(vec2_mask, vec2_b[0], 1.0f, vec2_a, vec2_radii, VEC2_COUNT);
+	});
+	Bench::add("bitmask/overlap_pixels_miss", bitmask_setup, [] {
+		vec2_mask[0] = Bitmask::overlap_pixels(ring, 0, 0, disc, 8, 8);
+	});
+	Bench::add("bitmask/overlap_miss", bitmask_setup, [] {
+		vec2_mask[0] = Bitmask::overlap(ring, 0, 0, disc, 8, 8);
+	});
+	Bench::add("bitmask/rotate_ship", arrow_masks_setup, [] {
+		turned = Bitmask::rotated(arrow_masks.rotations[0], Fixed(53));
+	});
+	// the systems that run in Scalar, build with ASTEROIDS_FIXED_POINT to compare
+	Bench::add("sim/tick_typical", world_typical, [] {
+		uint8_t inputs[2] = { INPUT_UP | INPUT_LEFT, INPUT_DOWN | INPUT_RIGHT };
+		world_restore(snapshot);
+		asteroids_tick(inputs);
+	});
+	Bench::add("sim/movement_full", world_full, [] {
+		for(unsigned i = 0; i < world.ship_n; ++i) {
+			world.ships[i].input.move_x = 1;
+			world.ships[i].input.move_y = 1;
+			world.ships[i].input.fire_cooldown = 1;
+			update_player_movement(world.ships[i]);
+		}
+		system_forward_movement();
+		system_keep_in_bounds();
+	});
+	Bench::add("sim/forward_movement_full", world_full, [] {
+		system_forward_movement();
+	});
+	Bench::add("sim/collisions_spread", world_spread, [] {
+		system_collisions();
+		world.event_n = 0;
+	});
+	// each broadphase forced, AUTO above should be as fast as the faster
+	Bench::add("sim/collisions_spread_all_pairs", world_spread, [] {
+		world.config.broadphase = BROADPHASE_ALL_PAIRS;
+		system_collisions();
+		world.event_n = 0;
+	});
+	Bench::add("sim/collisions_spread_sweep", world_spread, [] {
+		world.config.broadphase = BROADPHASE_SWEEP;
+		system_collisions();
+		world.event_n = 0;
+	});
+	// what netplay does on a misprediction at the rollback limit
+	Bench::add("rollback/8_ticks", world_typical, [] {
+		uint8_t inputs[2] = { INPUT_UP | INPUT_FIRE, INPUT_RIGHT };
+		world_restore(snapshot);
+		for(int i = 0; i < 8; ++i) {
+			asteroids_tick(inputs);
+		}
+	});
+}
+
+int main(int argc, char* argv[]) {
+	const char *filter = NULL;
+	const char *baseline_path = NULL;
+	const char *write_path = NULL;
+	int pin = -1;
+	bool render = false;
+	Bench::Options options;
+	for(int i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+			options.samples = std::max(5, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			options.warmup_ms = atof(argv[++i]);
+		} else if(strcmp(argv[i], "--pin") == 0 && i + 1 < argc) {
+			pin = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+			options.runs = std::max(1, atoi(argv[++i]));
+		} else if(strcmp(argv[i], "--render") == 0) {
+			render = true;
+		} else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baseline_path = argv[++i];
+		} else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+			options.threshold_percent = atof(argv[++i]);
+		} else if(strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) {
+			write_path = argv[++i];
+		} else if(argv[i][0] != '-') {
+			filter = argv[i];
+		}
+	}
+
+	std::string baseline_build;
+	std::vector<Bench::Result> baseline;
+	if(baseline_path != NULL) {
+		if(!Bench::read_baseline(baseline_path, baseline_build, baseline)) {
+			printf("could not read baseline %s\n", baseline_path);
+			return 2;
+		}
+		if(baseline_build != Bench::build_description()) {
+			printf("baseline %s is from another build (%s), this is %s\n", baseline_path, baseline_build.c_str(), Bench::build_description().c_str());
+			printf("write one for this build with --write-baseline\n");
+			return 2;
+		}
+	}
+
+	if(pin >= 0 && !Bench::pin_cpu(pin)) {
+		printf("could not pin to cpu %d, timings may be noisier\n", pin);
+	}
+
+	if(render) {
+		// runs without a display unless the driver is set explicitly
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+		if(!renderer_init("ASTEROIDS bench", 640, 360, 1)) {
+			printf("init renderer failed\n");
+			return 2;
+		}
+		Engine::init();
+		asteroids_load();
+	} else {
+		gw = 640;
+		gh = 360;
+	}
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / 60.0f;
+
+	world_snapshot_init(snapshot);
+	register_benchmarks();
+	register_system_benchmarks();
+	if(render) {
+		register_render_benchmarks();
+	}
+
+	printf("%s, %d samples, %d runs\n", Bench::build_description().c_str(), options.samples, options.runs);
+	std::vector<Bench::Result> results = Bench::run_all(filter, options);
+	FlightRecorder::stop();
+	if(results.empty()) {
+		printf("no benchmark matches %s\n", filter);
+		return 1;
+	}
+	if(write_path != NULL) {
+		if(!Bench::write_baseline(write_path, results)) {
+			printf("could not write %s\n", write_path);
+			return 2;
+		}
+		printf("wrote %s\n", write_path);
+	}
+	int regressions = 0;
+	if(baseline_path != NULL) {
+		regressions = Bench::compare(results, baseline, options);
+		if(regressions > 0) {
+			printf("\n%d benchmarks regressed by more than %.0f%%\n", regressions, options.threshold_percent);
+		}
+	}
+	if(render) {
+		renderer_destroy();
+	}
+	return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+// Determinism check, runs the headless simulation with scripted inputs and
+// reports the first tick where the state hashes of two runs differ
+// usage:
+//   diverge [ticks] [seed a] [seed b]         two runs in this process
+//   diverge --log <file> [ticks] [seed]       write the per tick hashes, e.g. on two machines
+//   diverge --compare <file a> <file b>       first divergent tick of two logs
+//   diverge --spin [ticks] [seed]             both players turn and fire without
+//                                             stopping, also fails if a heading
+//                                             leaves [0, 360) or is not unit length
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t INPUT_SEED = 1;
+static const int INPUT_HOLD_TICKS = 20;
+
+// Ticks where a ship angle was out of range or its heading not unit length
+static int bad_headings = 0;
+
+static void check_headings() {
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		Scalar angle = world.ships[i].angle;
+		Vec2 heading = Math::direction_deg(angle);
+		float length = Math::length_vector_f((float)heading.x, (float)heading.y);
+		if(angle < 0 || angle >= Scalar(360) || length < 0.99f || length > 1.01f) {
+			if(bad_headings == 0) {
+				printf("ship %u angle %f heading (%f, %f)\n", i, (float)angle, (float)heading.x, (float)heading.y);
+			}
+			bad_headings++;
+			return;
+		}
+	}
+}
+
+static void run(uint32_t seed, int ticks, std::vector<uint64_t> &hashes, bool spin = false) {
+	asteroids_new_game(seed);
+
+	// inputs come from their own stream so both runs see the same script
+	RandomGenerator script;
+	script.seed(INPUT_SEED);
+	uint8_t inputs[2] = { 0, 0 };
+
+	hashes.clear();
+	for(int tick = 0; tick < ticks; ++tick) {
+		if(spin) {
+			inputs[0] = INPUT_RIGHT | INPUT_FIRE;
+			inputs[1] = INPUT_LEFT | INPUT_FIRE;
+		} else if(tick % INPUT_HOLD_TICKS == 0) {
+			inputs[0] = (uint8_t)(script.next() & 0x3f);
+			inputs[1] = (uint8_t)(script.next() & 0x3f);
+		}
+		asteroids_tick(inputs);
+		Engine::frame_reset();
+		check_headings();
+		hashes.push_back(asteroids_state_hash());
+	}
+}
+
+static bool read_log(const char *path, std::vector<uint64_t> &hashes) {
+	std::ifstream file(path);
+	if(!file) {
+		printf("could not read %s\n", path);
+		return false;
+	}
+	int tick;
+	std::string hash;
+	while(file >> tick >> hash) {
+		hashes.push_back(strtoull(hash.c_str(), NULL, 16));
+	}
+	return true;
+}
+
+static int report(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) {
+	size_t ticks = std::min(a.size(), b.size());
+	for(size_t i = 0; i < ticks; ++i) {
+		if(a[i] != b[i]) {
+			printf("diverged at tick %u: %016llx != %016llx\n", (unsigned)i,
+				(unsigned long long)a[i], (unsigned long long)b[i]);
+			return 1;
+		}
+	}
+	if(a.size() != b.size()) {
+		printf("identical for %u ticks, then one run ends\n", (unsigned)ticks);
+		return 1;
+	}
+	printf("identical for %u ticks\n", (unsigned)ticks);
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	gw = 640;
+	gh = 360;
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / 60.0f;
+
+	if(argc > 3 && strcmp(argv[1], "--compare") == 0) {
+		std::vector<uint64_t> a, b;
+		if(!read_log(argv[2], a) || !read_log(argv[3], b)) {
+			return 2;
+		}
+		return report(a, b);
+	}
+
+	if(argc > 2 && strcmp(argv[1], "--log") == 0) {
+		int ticks = argc > 3 ? atoi(argv[3]) : 36000;
+		uint32_t seed = argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 10) : 1;
+		std::vector<uint64_t> hashes;
+		run(seed, ticks, hashes);
+		std::ofstream file(argv[2]);
+		for(size_t i = 0; i < hashes.size(); ++i) {
+			char line[64];
+			snprintf(line, sizeof(line), "%u %016llx\n", (unsigned)i, (unsigned long long)hashes[i]);
+			file << line;
+		}
+		printf("wrote %u tick hashes to %s\n", (unsigned)hashes.size(), argv[2]);
+		return file ? 0 : 2;
+	}
+
+	if(argc > 1 && strcmp(argv[1], "--spin") == 0) {
+		int ticks = argc > 2 ? atoi(argv[2]) : 36000;
+		uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 1;
+		std::vector<uint64_t> a, b;
+		run(seed, ticks, a, true);
+		run(seed, ticks, b, true);
+		int result = report(a, b);
+		if(bad_headings > 0) {
+			printf("FAILED: bad ship heading on %d ticks\n", bad_headings);
+			return 1;
+		}
+		return result;
+	}
+
+	int ticks = argc > 1 ? atoi(argv[1]) : 36000;
+	uint32_t seed_a = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+	uint32_t seed_b = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : seed_a;
+	std::vector<uint64_t> a, b;
+	run(seed_a, ticks, a);
+	run(seed_b, ticks, b);
+	int result = report(a, b);
+	if(bad_headings > 0) {
+		printf("FAILED: bad ship heading on %d ticks\n", bad_headings);
+		return 1;
+	}
+	return result;
+}
@@ -0,0 +1,99 @@
+// Netplay test over localhost, both peers run in this process with their own
+// GameWorld and scripted inputs over a simulated bad connection. At the end
+// the confirmed state of both is compared with an offline run of the same inputs.
+// usage: netloop [frames] [latency ms] [jitter ms] [loss %]
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include "netplay.h"
+#include <cstdlib>
+
+static const uint16_t PORT_BASE = 47000;
+static const uint32_t SEED = 1234;
+
+static Netplay::Session sessions[2];
+static GameWorld worlds[2];
+
+// the input of a player is a function of the frame, so the offline run can rebuild it
+static uint8_t input_for(int player, int frame) {
+	if(frame < Netplay::INPUT_DELAY) {
+		return 0;
+	}
+	uint32_t x = (uint32_t)(frame / 15) * 2654435761u + (uint32_t)player * 40503u;
+	x ^= x >> 15;
+	x *= 2246822519u;
+	x ^= x >> 13;
+	return (uint8_t)(x & 0x3f);
+}
+
+static void update_peer(int player) {
+	Netplay::Session &s = sessions[player];
+	// each peer simulates in its own world
+	std::swap(world, worlds[player]);
+	Netplay::update(s, input_for(player, s.frame + Netplay::INPUT_DELAY));
+	std::swap(world, worlds[player]);
+}
+
+static uint64_t offline_hash(int last_frame) {
+	asteroids_new_game(SEED);
+	for(int f = 0; f <= last_frame; ++f) {
+		uint8_t inputs[2] = { input_for(0, f), input_for(1, f) };
+		asteroids_tick(inputs);
+	}
+	return asteroids_state_hash();
+}
+
+int main(int argc, char* argv[]) {
+	int frames = argc > 1 ? atoi(argv[1]) : 600;
+	Net::Conditions conditions;
+	conditions.latency_ms = argc > 2 ? atoi(argv[2]) : 50;
+	conditions.jitter_ms = argc > 3 ? atoi(argv[3]) : 10;
+	conditions.loss = argc > 4 ? (float)atof(argv[4]) / 100.0f : 0.05f;
+
+	gw = 640;
+	gh = 360;
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / 60.0f;
+
+	if(!Net::init()) {
+		return 2;
+	}
+	for(int p = 0; p < 2; ++p) {
+		if(!Netplay::start(sessions[p], PORT_BASE + p, "127.0.0.1", PORT_BASE + 1 - p, p, p == 0 ? SEED : 0)) {
+			return 2;
+		}
+		Net::socket_set_conditions(sessions[p].socket, conditions);
+		// different drop patterns for the two directions
+		sessions[p].socket.random_state += p;
+	}
+
+	// run at the real tick rate so the simulated latency means what it says
+	int last = frames - 1;
+	Uint32 deadline = SDL_GetTicks() + (Uint32)(frames * 3 * 1000 / 60) + 5000;
+	while(sessions[0].remote_frame < last || sessions[1].remote_frame < last
+		|| sessions[0].frame <= last || sessions[1].frame <= last) {
+		if(SDL_TICKS_PASSED(SDL_GetTicks(), deadline)) {
+			printf("timed out at frames %d / %d\n", sessions[0].frame, sessions[1].frame);
+			return 1;
+		}
+		update_peer(0);
+		update_peer(1);
+		SDL_Delay(16);
+	}
+
+	bool ok = true;
+	uint64_t expected = offline_hash(last);
+	for(int p = 0; p < 2; ++p) {
+		Netplay::print_stats(sessions[p]);
+		uint64_t hash = sessions[p].hashes[Netplay::slot(last)];
+		if(hash != expected || sessions[p].desync_frame >= 0) {
+			printf("player %d frame %d: %016llx, offline %016llx\n", p, last,
+				(unsigned long long)hash, (unsigned long long)expected);
+			ok = false;
+		}
+		Netplay::stop(sessions[p]);
+	}
+	Net::shutdown();
+
+	printf(ok ? "OK: both peers match the offline run\n" : "FAILED: peers diverged\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Offline asset packer, writes the archive read by Pack::open
+// usage: packer <output.pak> <data folder> <file>...
+// .png files are decoded and stored as raw pixels, everything else is stored as is
+#include "pack.h"
+#include "renderer.h"
+#include "SDL_image.h"
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+// ARGB8888 is the first texture format of the direct3d and opengl renderers,
+// so SDL_UpdateTexture can upload it without converting
+static const Uint32 PACK_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+struct PackItem {
+	Pack::Entry entry;
+	std::vector<uint8_t> data;
+};
+
+static bool ends_with(const std::string &s, const std::string &suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool read_file(const std::string &path, std::vector<uint8_t> &data) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if(!file) {
+		return false;
+	}
+	data.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)data.data(), data.size());
+	return (bool)file;
+}
+
+static bool pack_image(const std::string &path, PackItem &item) {
+	SDL_Surface *loaded = IMG_Load(path.c_str());
+	if(loaded == NULL) {
+		printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError());
+		return false;
+	}
+	SDL_Surface *converted = SDL_ConvertSurfaceFormat(loaded, PACK_PIXEL_FORMAT, 0);
+	SDL_FreeSurface(loaded);
+	if(converted == NULL) {
+		printf("Unable to convert image %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
+		return false;
+	}
+
+	item.entry.type = Pack::Image;
+	item.entry.format = PACK_PIXEL_FORMAT;
+	item.entry.w = converted->w;
+	item.entry.h = converted->h;
+	item.entry.pitch = converted->w * SDL_BYTESPERPIXEL(PACK_PIXEL_FORMAT);
+	item.data.resize((size_t)item.entry.pitch * converted->h);
+	SDL_LockSurface(converted);
+	for(int y = 0; y < converted->h; ++y) {
+		memcpy(&item.data[(size_t)y * item.entry.pitch], (uint8_t*)converted->pixels + (size_t)y * converted->pitch, item.entry.pitch);
+	}
+	SDL_UnlockSurface(converted);
+	SDL_FreeSurface(converted);
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	if(argc < 4) {
+		printf("usage: packer <output.pak> <data folder> <file>...\n");
+		return 1;
+	}
+	std::string output = argv[1];
+	std::string folder = std::string(argv[2]) + "/";
+
+	std::vector<PackItem> items(argc - 3);
+	for(int i = 3; i < argc; ++i) {
+		std::string filename = argv[i];
+		PackItem &item = items[i - 3];
+		item.entry = Pack::Entry();
+		item.entry.name = Resources::name_hash(filename.c_str());
+		bool ok = ends_with(filename, ".png") 
+			? pack_image(folder + filename, item) 
+			: read_file(folder + filename, item.data);
+		if(!ok) {
+			printf("Failed to pack %s\n", filename.c_str());
+			return 1;
+		}
+		if(!ends_with(filename, ".png")) {
+			item.entry.type = Pack::Blob;
+		}
+		item.entry.size = item.data.size();
+		printf("packed %s (%u bytes)\n", filename.c_str(), (unsigned)item.data.size());
+	}
+
+	Pack::Header header = { Pack::MAGIC, Pack::VERSION, (uint32_t)items.size(), 0 };
+	uint64_t offset = sizeof(Pack::Header) + items.size() * sizeof(Pack::Entry);
+	for(auto &item : items) {
+		offset = (offset + Pack::DATA_ALIGNMENT - 1) & ~(uint64_t)(Pack::DATA_ALIGNMENT - 1);
+		item.entry.offset = offset;
+		offset += item.entry.size;
+	}
+
+	std::ofstream file(output, std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	for(auto &item : items) {
+		file.write((const char*)&item.entry, sizeof(Pack::Entry));
+	}
+	for(auto &item : items) {
+		const char padding[Pack::DATA_ALIGNMENT] = {};
+		file.write(padding, item.entry.offset - (uint64_t)file.tellp());
+		file.write((const char*)item.data.data(), item.data.size());
+	}
+	if(!file) {
+		printf("Failed to write %s\n", output.c_str());
+		return 1;
+	}
+	printf("wrote %s\n", output.c_str());
+	return 0;
+}
@@ -0,0 +1,124 @@
+// Replay tool
+// usage:
+//   replay record <file> [ticks] [seed]   headless game with scripted inputs, for soak tests
+//   replay info <file>                    header, chunks and size
+//   replay verify <file>                  plays it through and checks every keyframe is reached,
+//                                         also reproduces flight recorder dumps (crash.rpl)
+//   replay seek <file> <tick>             time a seek and print the state hash there
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include "replay.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t INPUT_SEED = 1;
+static const int INPUT_HOLD_TICKS = 20;
+
+static double ms_since(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int record(const char *path, int ticks, uint32_t seed) {
+	static Replay::Recorder recorder;
+	asteroids_new_game(seed);
+	if(!Replay::record_start(recorder, path, seed)) {
+		return 2;
+	}
+	RandomGenerator script;
+	script.seed(INPUT_SEED);
+	uint8_t inputs[2] = { 0, 0 };
+	double tick_ms_max = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for(int tick = 0; tick < ticks; ++tick) {
+		if(tick % INPUT_HOLD_TICKS == 0) {
+			inputs[0] = (uint8_t)(script.next() & 0x3f);
+			inputs[1] = (uint8_t)(script.next() & 0x3f);
+		}
+		auto tick_start = std::chrono::steady_clock::now();
+		Replay::record_tick(recorder, inputs);
+		asteroids_tick(inputs);
+		tick_ms_max = std::max(tick_ms_max, ms_since(tick_start));
+	}
+	double ms = ms_since(start);
+	if(!Replay::record_stop(recorder)) {
+		printf("writing %s failed\n", path);
+		return 2;
+	}
+	printf("recorded %d ticks in %.1f ms, slowest tick %.3f ms, final hash %016llx\n", ticks, ms, tick_ms_max,
+		(unsigned long long)asteroids_state_hash());
+	return 0;
+}
+
+static int info(const char *path) {
+	Replay::Player player;
+	if(!Replay::play_open(player, path)) {
+		return 2;
+	}
+	uint64_t file_size = player.footer.index_offset + player.index.size() * sizeof(Replay::IndexEntry) + sizeof(Replay::Footer);
+	// flight recorder dumps start at a later tick
+	uint32_t first_tick = player.index.empty() ? 0 : player.index[0].first_tick;
+	uint32_t ticks = Replay::total_ticks(player) - first_tick;
+	printf("seed %u, ticks %u - %u (%.1f s), keyframe every %u ticks, %u chunks, %llu bytes\n",
+		player.header.seed, first_tick, Replay::total_ticks(player), ticks / (float)Replay::TICK_RATE,
+		player.header.keyframe_interval, (unsigned)player.index.size(), (unsigned long long)file_size);
+	Replay::play_close(player);
+	return 0;
+}
+
+static int verify(const char *path) {
+	Replay::Player player;
+	if(!Replay::play_open(player, path)) {
+		return 2;
+	}
+	player.verify = true;
+	auto start = std::chrono::steady_clock::now();
+	while(Replay::step(player)) {
+	}
+	double ms = ms_since(start);
+	bool ok = player.tick == Replay::total_ticks(player) && player.mismatch_tick < 0;
+	if(player.mismatch_tick >= 0) {
+		printf("playback does not match the keyframe at tick %d\n", player.mismatch_tick);
+	}
+	printf("played %u ticks in %.1f ms, final hash %016llx\n", player.tick, ms, (unsigned long long)asteroids_state_hash());
+	Replay::play_close(player);
+	return ok ? 0 : 1;
+}
+
+static int seek(const char *path, uint32_t tick) {
+	Replay::Player player;
+	if(!Replay::play_open(player, path)) {
+		return 2;
+	}
+	auto start = std::chrono::steady_clock::now();
+	bool ok = Replay::seek(player, tick);
+	double ms = ms_since(start);
+	if(ok) {
+		printf("seek to tick %u in %.3f ms, hash %016llx\n", tick, ms, (unsigned long long)asteroids_state_hash());
+	} else {
+		printf("could not seek to tick %u\n", tick);
+	}
+	Replay::play_close(player);
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+	gw = 640;
+	gh = 360;
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / 60.0f;
+
+	if(argc > 2 && strcmp(argv[1], "record") == 0) {
+		int ticks = argc > 3 ? atoi(argv[3]) : 36000;
+		uint32_t seed = argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 10) : 1;
+		return record(argv[2], ticks, seed);
+	} else if(argc > 2 && strcmp(argv[1], "info") == 0) {
+		return info(argv[2]);
+	} else if(argc > 2 && strcmp(argv[1], "verify") == 0) {
+		return verify(argv[2]);
+	} else if(argc > 3 && strcmp(argv[1], "seek") == 0) {
+		return seek(argv[2], (uint32_t)strtoul(argv[3], NULL, 10));
+	}
+	printf("usage: replay record|info|verify|seek <file> ...\n");
+	return 2;
+}
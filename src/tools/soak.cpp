@@ -0,0 +1,116 @@
+// Soak test, headless games flown by bot pilots with growing ship counts.
+// Prints the tick time for each count so scaling can be compared, and the
+// flight recorder writes soak_crash.rpl if an assert fires. Fails if a ship
+// angle leaves [0, 360), spinner pilots turn without stopping to check it.
+// usage: soak [ticks] [seed] [hunter|sentry|spinner]
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include "replay.h"
+#include "flight_recorder.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static const int SHIP_COUNTS[] = { 1, 2, 5, 10, 20, 50, 100 };
+static const char *PILOT_NAMES[PILOT_COUNT] = { "player", "hunter", "sentry", "spinner" };
+
+struct SoakResult {
+	double ms;
+	double tick_us_p99;
+	double tick_us_max;
+	double ships;
+	double asteroids;
+	double bullets;
+	// queue_event calls a tick, and the share merged into earlier events
+	double events;
+	double merged;
+	int resets;
+	// ticks that ended with a ship angle outside [0, 360)
+	int bad_angles;
+};
+
+static SoakResult soak(int bots, int pilot, int ticks, uint32_t seed) {
+	world.config.player_count = 0;
+	world.config.bot_count = bots;
+	world.config.bot_pilot = pilot;
+	asteroids_new_game(seed);
+	FlightRecorder::start("soak_crash.rpl");
+
+	// bots need no input, the players slots stay empty
+	uint8_t inputs[2] = { 0, 0 };
+	std::vector<double> tick_us(ticks);
+	SoakResult r = {};
+	Events::Counters counters = Events::counters;
+	bool was_inactive = false;
+	auto start = std::chrono::steady_clock::now();
+	for(int tick = 0; tick < ticks; ++tick) {
+		auto tick_start = std::chrono::steady_clock::now();
+		FlightRecorder::record_tick(inputs);
+		asteroids_tick(inputs);
+		tick_us[tick] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tick_start).count();
+
+		r.ships += world.ship_n;
+		r.asteroids += world.asteroid_n;
+		r.bullets += world.bullets_n;
+		for(unsigned i = 0; i < world.ship_n; ++i) {
+			if(world.ships[i].angle < 0 || world.ships[i].angle >= Scalar(360)) {
+				r.bad_angles++;
+				break;
+			}
+		}
+		if(world.game_state.inactive && !was_inactive) {
+			r.resets++;
+		}
+		was_inactive = world.game_state.inactive;
+	}
+	FlightRecorder::stop();
+	r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	r.ships /= ticks;
+	r.asteroids /= ticks;
+	r.bullets /= ticks;
+	for(int type = 0; type < Events::TYPE_COUNT; ++type) {
+		r.events += (double)(Events::counters.raised[type] - counters.raised[type]);
+		r.merged += (double)(Events::counters.merged[type] - counters.merged[type]);
+	}
+	r.merged = r.events > 0 ? 100.0 * r.merged / r.events : 0.0;
+	r.events /= ticks;
+	std::sort(tick_us.begin(), tick_us.end());
+	r.tick_us_p99 = tick_us[ticks * 99 / 100];
+	r.tick_us_max = tick_us[ticks - 1];
+	return r;
+}
+
+int main(int argc, char* argv[]) {
+	gw = 640;
+	gh = 360;
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / 60.0f;
+
+	int ticks = argc > 1 ? atoi(argv[1]) : 36000;
+	uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+	int pilot = PILOT_HUNTER;
+	for(int i = PILOT_HUNTER; argc > 3 && i < PILOT_COUNT; ++i) {
+		if(strcmp(argv[3], PILOT_NAMES[i]) == 0) {
+			pilot = i;
+		}
+	}
+	if(ticks <= 0) {
+		printf("usage: soak [ticks] [seed] [hunter|sentry|spinner]\n");
+		return 2;
+	}
+
+	printf("%d ticks per run, seed %u, %s pilots\n", ticks, seed, PILOT_NAMES[pilot]);
+	printf("%5s %10s %10s %10s %10s %8s %9s %8s %7s %8s %7s %6s\n",
+		"bots", "ticks/s", "mean us", "p99 us", "max us", "ships", "asteroids", "bullets", "events", "merged %", "resets", "hash");
+	for(int bots : SHIP_COUNTS) {
+		SoakResult r = soak(bots, pilot, ticks, seed);
+		printf("%5d %10.0f %10.2f %10.2f %10.2f %8.1f %9.1f %8.1f %7.2f %8.1f %7d %06llx\n",
+			bots, ticks / (r.ms / 1000.0), r.ms * 1000.0 / ticks, r.tick_us_p99, r.tick_us_max,
+			r.ships, r.asteroids, r.bullets, r.events, r.merged, r.resets, (unsigned long long)(asteroids_state_hash() & 0xffffff));
+		if(r.bad_angles > 0) {
+			printf("FAILED: ship angle outside [0, 360) on %d ticks\n", r.bad_angles);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,274 @@
+// Stress scenarios. A scenario describes a world far past a normal game:
+// entity counts, how asteroids move, whether they split and how fast
+// bullets are fired. The runner sweeps scenario families over entity counts,
+// runs each for a time budget and writes a CSV line per scenario with
+// ticks/s, tick time percentiles and memory, to show where a system stops
+// scaling.
+// usage: stress [out.csv] [max entities] [seconds per scenario]
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Counting global new/delete for the heap columns, a size header in front of
+// every block
+namespace HeapTracking {
+	static const size_t HEADER = 16;
+	static size_t current = 0;
+	static size_t peak = 0;
+
+	static void *allocate(size_t size) {
+		char *p = (char*)malloc(size + HEADER);
+		if(p == NULL) {
+			throw std::bad_alloc();
+		}
+		*(size_t*)p = size;
+		current += size;
+		peak = std::max(peak, current);
+		return p + HEADER;
+	}
+	static void release(void *ptr) {
+		if(ptr == NULL) {
+			return;
+		}
+		char *p = (char*)ptr - HEADER;
+		current -= *(size_t*)p;
+		free(p);
+	}
+}
+
+void *operator new(size_t size) { return HeapTracking::allocate(size); }
+void *operator new[](size_t size) { return HeapTracking::allocate(size); }
+void operator delete(void *ptr) noexcept { HeapTracking::release(ptr); }
+void operator delete[](void *ptr) noexcept { HeapTracking::release(ptr); }
+void operator delete(void *ptr, size_t) noexcept { HeapTracking::release(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { HeapTracking::release(ptr); }
+
+enum Motion {
+	MOTION_STILL,
+	// each axis uniform in [-speed, speed]
+	MOTION_RANDOM,
+	// everything heading the same way at speed, with a tenth of it as spread
+	MOTION_STREAM
+};
+
+struct Scenario {
+	char name[64];
+	unsigned asteroids;
+	// 1 splits twice when shot, 3 does not split
+	int asteroid_size;
+	Motion motion;
+	float speed;
+	unsigned bullets;
+	// fired from random places in random directions, on top of the bots
+	float bullets_per_tick;
+	float bullet_seconds;
+	// hunter bots that never die, so the game never resets
+	int bots;
+	float fire_cooldown;
+	// width and height of the field in screens
+	float field;
+	// world.config.spatial_order
+	bool spatial_order;
+};
+
+struct ScenarioResult {
+	int ticks;
+	double seconds;
+	double tick_ms_mean;
+	double tick_ms_p50;
+	double tick_ms_p99;
+	double tick_ms_max;
+	double asteroids;
+	double bullets;
+	size_t world_bytes;
+	// everything the process had allocated at the worst moment of the run
+	size_t heap_peak_bytes;
+};
+
+static const uint32_t SCENARIO_SEED = 1;
+static const int MAX_TICKS = 600;
+static const int TICK_RATE = 60;
+
+static RandomGenerator rng;
+
+static Vec2 random_position() {
+	return { RNG::range_f(rng, 0.0f, (float)gw), RNG::range_f(rng, 0.0f, (float)gh) };
+}
+
+static Vec2 random_velocity(const Scenario &s) {
+	switch(s.motion) {
+		case MOTION_RANDOM:
+			return { RNG::range_f(rng, -s.speed, s.speed), RNG::range_f(rng, -s.speed, s.speed) };
+		case MOTION_STREAM: {
+			float spread = s.speed * 0.1f;
+			return { s.speed + RNG::range_f(rng, -spread, spread), s.speed * 0.5f + RNG::range_f(rng, -spread, spread) };
+		}
+		default:
+			return { 0, 0 };
+	}
+}
+
+static void fire_random_bullet(const Scenario &s) {
+	Vec2 direction = Math::direction_deg(Scalar(RNG::range_f(rng, 0.0f, 360.0f)));
+	spawn_bullet(random_position(), direction, world.config.player_faction_1, s.bullet_seconds);
+}
+
+static size_t world_bytes() {
+	return world.ships.capacity() * sizeof(Ship)
+		+ world.asteroids.capacity() * sizeof(Asteroid)
+		+ world.bullets.capacity() * sizeof(Bullet)
+		+ world.event_queue.capacity() * sizeof(Event);
+}
+
+static void build(const Scenario &s) {
+	gw = (int)(640 * s.field);
+	gh = (int)(360 * s.field);
+	// splits can leave up to four asteroids per size 1 asteroid
+	unsigned asteroid_capacity = std::max(GameWorld::MAX_ASTEROIDS, s.asteroids * (s.asteroid_size == 1 ? 4 : s.asteroid_size == 2 ? 2 : 1));
+	unsigned bullet_capacity = std::max(GameWorld::MAX_BULLETS, s.bullets + (unsigned)(s.bullets_per_tick * TICK_RATE * s.bullet_seconds) + s.bots * 100);
+	// three events per destroyed asteroid, a shot per ship and a hit per ship and asteroid
+	unsigned ships = std::max(GameWorld::MAX_SHIPS, (unsigned)s.bots);
+	unsigned events = GameWorld::MAX_EVENTS + 3 * asteroid_capacity + ships + s.bots * asteroid_capacity;
+	world_set_capacity(world, ships, asteroid_capacity, bullet_capacity, events);
+
+	world.config = AsteroidsConfig();
+	world.config.player_count = 0;
+	world.config.bot_count = s.bots;
+	world.config.bot_pilot = PILOT_HUNTER;
+	world.config.fire_cooldown = s.fire_cooldown;
+	world.config.bullet_time_to_live = s.bullet_seconds;
+	world.config.spatial_order = s.spatial_order;
+	asteroids_new_game(SCENARIO_SEED);
+	for(unsigned i = 0; i < world.ship_n; ++i) {
+		world.ships[i].health = INT_MAX;
+	}
+
+	rng.seed(SCENARIO_SEED);
+	world.asteroid_n = 0;
+	for(unsigned i = 0; i < s.asteroids; ++i) {
+		Vec2 position = random_position();
+		spawn_asteroid(position, random_velocity(s), s.asteroid_size);
+	}
+	world.bullets_n = 0;
+	for(unsigned i = 0; i < s.bullets; ++i) {
+		fire_random_bullet(s);
+	}
+}
+
+static ScenarioResult run(const Scenario &s, double seconds) {
+	ScenarioResult r = {};
+	HeapTracking::peak = HeapTracking::current;
+	build(s);
+	r.world_bytes = world_bytes();
+
+	std::vector<double> tick_ms;
+	tick_ms.reserve(MAX_TICKS);
+	uint8_t inputs[2] = { 0, 0 };
+	float bullets_due = 0.0f;
+	auto start = std::chrono::steady_clock::now();
+	while(r.ticks < MAX_TICKS && (r.ticks == 0 || r.seconds < seconds)) {
+		for(bullets_due += s.bullets_per_tick; bullets_due >= 1.0f; bullets_due -= 1.0f) {
+			fire_random_bullet(s);
+		}
+		auto tick_start = std::chrono::steady_clock::now();
+		asteroids_tick(inputs);
+		auto tick_end = std::chrono::steady_clock::now();
+		tick_ms.push_back(std::chrono::duration<double, std::milli>(tick_end - tick_start).count());
+		r.asteroids += world.asteroid_n;
+		r.bullets += world.bullets_n;
+		r.ticks++;
+		r.seconds = std::chrono::duration<double>(tick_end - start).count();
+	}
+
+	double total_ms = 0.0;
+	for(double ms : tick_ms) {
+		total_ms += ms;
+	}
+	r.tick_ms_mean = total_ms / r.ticks;
+	std::sort(tick_ms.begin(), tick_ms.end());
+	r.tick_ms_p50 = tick_ms[r.ticks / 2];
+	r.tick_ms_p99 = tick_ms[r.ticks * 99 / 100];
+	r.tick_ms_max = tick_ms.back();
+	r.asteroids /= r.ticks;
+	r.bullets /= r.ticks;
+	r.heap_peak_bytes = HeapTracking::peak;
+	return r;
+}
+
+// Each family at each entity count, 10, 100, ... up to max_entities
+static std::vector<Scenario> sweep(unsigned max_entities) {
+	std::vector<Scenario> scenarios;
+	for(unsigned n = 10; n <= max_entities; n *= 10) {
+		Scenario s;
+		// asteroids alone, movement and bounds
+		s = { "", n, 3, MOTION_RANDOM, 1.0f, 0, 0.0f, 1.0f, 0, 0.25f, 1.0f, false };
+		snprintf(s.name, sizeof(s.name), "drift_%u", n);
+		scenarios.push_back(s);
+		// bullets alone, spawning and cleanup
+		s = { "", 10, 3, MOTION_STILL, 0.0f, n, n / 60.0f, 20.0f, 1, 0.25f, 1.0f, false };
+		snprintf(s.name, sizeof(s.name), "barrage_%u", n);
+		scenarios.push_back(s);
+		// both, with splitting, the collision worst case
+		s = { "", n, 1, MOTION_RANDOM, 1.0f, n, n / 60.0f, 20.0f, 2, 0.1f, 1.0f, false };
+		snprintf(s.name, sizeof(s.name), "field_%u", n);
+		scenarios.push_back(s);
+		// coherent motion, neighbours stay neighbours
+		s = { "", n, 2, MOTION_STREAM, 2.0f, n / 10, n / 600.0f, 20.0f, 2, 0.1f, 1.0f, false };
+		snprintf(s.name, sizeof(s.name), "stream_%u", n);
+		scenarios.push_back(s);
+		// a field grown with the count so it stays as sparse as a normal game
+		float field = std::max(1.0f, sqrtf(n / 100.0f));
+		s = { "", n, 3, MOTION_RANDOM, 1.0f, n, n / 600.0f, 20.0f, 2, 0.1f, field, false };
+		snprintf(s.name, sizeof(s.name), "sparse_%u", n);
+		scenarios.push_back(s);
+		// the same kept sorted along x in memory
+		s.spatial_order = true;
+		snprintf(s.name, sizeof(s.name), "sorted_%u", n);
+		scenarios.push_back(s);
+		// ships, pilots and ship collisions, up to the ship capacity
+		if(n / 10 <= GameWorld::MAX_SHIPS) {
+			s = { "", 100, 1, MOTION_RANDOM, 1.0f, 0, 0.0f, 20.0f, (int)std::max(n / 10, 1u), 0.1f, 1.0f, false };
+			snprintf(s.name, sizeof(s.name), "bots_%d", s.bots);
+			scenarios.push_back(s);
+		}
+	}
+	return scenarios;
+}
+
+int main(int argc, char* argv[]) {
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / TICK_RATE;
+
+	const char *path = argc > 1 ? argv[1] : NULL;
+	unsigned max_entities = argc > 2 ? (unsigned)strtoul(argv[2], NULL, 10) : 100000;
+	double seconds = argc > 3 ? atof(argv[3]) : 2.0;
+
+	FILE *out = stdout;
+	if(path != NULL && strcmp(path, "-") != 0) {
+		out = fopen(path, "w");
+		if(out == NULL) {
+			printf("could not open %s\n", path);
+			return 2;
+		}
+	}
+	fprintf(out, "scenario,asteroids,bullets,bots,ticks,ticks_per_s,tick_ms_mean,tick_ms_p50,tick_ms_p99,tick_ms_max,"
+		"avg_asteroids,avg_bullets,world_kb,heap_peak_kb\n");
+	for(const Scenario &s : sweep(max_entities)) {
+		fprintf(stderr, "%s\n", s.name);
+		ScenarioResult r = run(s, seconds);
+		fprintf(out, "%s,%u,%u,%d,%d,%.1f,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f,%.1f,%.1f\n",
+			s.name, s.asteroids, s.bullets, s.bots, r.ticks, r.ticks / r.seconds,
+			r.tick_ms_mean, r.tick_ms_p50, r.tick_ms_p99, r.tick_ms_max,
+			r.asteroids, r.bullets, r.world_bytes / 1024.0, r.heap_peak_bytes / 1024.0);
+		fflush(out);
+	}
+	if(out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
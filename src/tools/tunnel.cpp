@@ -0,0 +1,68 @@
+// Tunneling check, fires bullets past a still radius 8 asteroid at the
+// bullet speed a lower tick rate needs and counts the hits. Every bullet
+// passes within touching distance, so all of them should hit.
+// Prints the share a test of the end positions of each tick would catch and
+// the share system_collisions catches.
+// usage: tunnel [tick rate hz] [bullets]
+#include "engine.h"
+#include "renderer.h"
+#include "asteroids.h"
+#include <cstdlib>
+
+// the bullet speed of the game at 60 Hz, per second
+static const float BULLET_PX_PER_SECOND = 5.0f * 60.0f;
+
+int main(int argc, char* argv[]) {
+	gw = 640;
+	gh = 360;
+	float hz = argc > 1 ? (float)atof(argv[1]) : 20.0f;
+	int bullets = argc > 2 ? atoi(argv[2]) : 10000;
+	if(hz <= 0.0f || bullets <= 0) {
+		printf("usage: tunnel [tick rate hz] [bullets]\n");
+		return 2;
+	}
+	Time::delta_time = Time::delta_time_fixed = Time::delta_time_raw = 1.0f / hz;
+	float speed = BULLET_PX_PER_SECOND / hz;
+
+	// bullets are removed once no ship is left, one player waits in a corner
+	world.config.player_count = 1;
+	world.config.player_bullet_speed = speed;
+	asteroids_new_game(1);
+	RandomGenerator rng;
+	rng.seed(1);
+	Vec2 center = { gw / 2.0f, gh / 2.0f };
+	Scalar radius = Scalar(8.0f);
+	uint8_t inputs[2] = { 0, 0 };
+
+	int end_hits = 0;
+	int swept_hits = 0;
+	for(int i = 0; i < bullets; ++i) {
+		world.asteroid_n = 0;
+		world.bullets_n = 0;
+		world.ships[0].position = { 20, 20 };
+		spawn_asteroid(center, { 0, 0 }, 3);
+		// anywhere across the asteroid and a random phase along the path,
+		// so the tick ends fall at every distance from its center
+		float offset = RNG::range_f(rng, -8.9f, 8.9f);
+		Vec2 start = { center.x - 100.0f - RNG::range_f(rng, 0.0f, speed), center.y + offset };
+		Vec2 direction = { 1, 0 };
+		spawn_bullet(start, direction, world.config.player_faction_1, 1000.0f);
+		Scalar bullet_radius = Scalar(world.bullets[0].radius);
+
+		bool end_hit = false;
+		Vec2 p = start;
+		for(int t = 0; t * speed < 200.0f; ++t) {
+			p += direction * Scalar(speed);
+			end_hit = end_hit || Math::intersect_circles(p, bullet_radius, center, radius);
+		}
+		end_hits += end_hit;
+
+		for(int t = 0; t * speed < 200.0f && world.asteroid_n == 1; ++t) {
+			asteroids_tick(inputs);
+		}
+		swept_hits += world.asteroid_n != 1;
+	}
+	printf("%.0f Hz, bullets %.0f px/tick past a radius 8 asteroid, %d bullets\n", hz, speed, bullets);
+	printf("tick end overlap %.1f%%, system_collisions %.1f%%\n", 100.0 * end_hits / bullets, 100.0 * swept_hits / bullets);
+	return swept_hits == bullets ? 0 : 1;
+}